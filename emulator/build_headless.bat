@@ -0,0 +1,20 @@
+@pushd %~dp0%
+
+@set include=-I"libs\SDL2-2.26.4\x86_64-w64-mingw32\include\SDL2" -I"libs\SDL2_image-2.6.3\x86_64-w64-mingw32\include\SDL2" -I"libs\lua-5.3.6\include"
+
+@set compiler=%include% -Wall -pedantic -std=c++2a -DCASIOEMU_HEADLESS
+
+@set linker=-L"libs\SDL2-2.26.4\x86_64-w64-mingw32\lib" -L"libs\SDL2_image-2.6.3\x86_64-w64-mingw32\lib" -L"libs\lua-5.3.6"
+@set linker=%linker% -lmingw32 -lSDL2main -lSDL2 -lSDL2_image -llua53
+
+@set files=src\casioemu_headless.cpp src\Emulator.cpp src\Logger.cpp
+@set files=%files% src\Chipset\CPU.cpp src\Chipset\CPUPushPop.cpp src\Chipset\MMURegion.cpp src\Chipset\CPUControl.cpp src\Chipset\CPUArithmetic.cpp src\Chipset\CPULoadStore.cpp src\Chipset\CPUTranslate.cpp src\Chipset\Chipset.cpp src\Chipset\MMU.cpp src\Chipset\InterruptSource.cpp
+@set files=%files% src\Peripheral\BatteryBackedRAM.cpp src\Peripheral\Peripheral.cpp src\Peripheral\Keyboard.cpp src\Peripheral\Screen.cpp src\Peripheral\Timer.cpp src\Peripheral\StandbyControl.cpp src\Peripheral\ROMWindow.cpp src\Peripheral\Miscellaneous.cpp
+@set files=%files% src\Peripheral\BCDCalc.cpp src\Peripheral\PowerSupply.cpp src\Peripheral\TimerBaseCounter.cpp src\Peripheral\RealTimeClock.cpp src\Peripheral\WatchdogTimer.cpp src\Peripheral\ExternalInterrupts.cpp src\Peripheral\IOPorts.cpp
+@set files=%files% src\Data\ModelInfo.cpp
+
+@set output_exe=casioemu_headless.exe
+
+g++ %compiler% %files% %linker% -O2 -o %output_exe%
+
+@popd
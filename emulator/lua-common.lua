@@ -61,38 +61,30 @@ function break_at(addr, commands)
 		commands = function() end
 	end
 
-    if not next(break_targets) then
-        -- if break_targets is initially empty and later non-empty
-		addposttick(break_posttick)
+	if break_targets[addr] then
+		emu:unhook(break_targets[addr])
 	end
-
-	break_targets[addr] = commands
+	-- a native PC check, Lua only runs when the breakpoint is hit
+	break_targets[addr] = emu:hook(function()
+		emu:set_paused(true)
+		commands()
+	end, {pc = addr})
 end
 
 function unbreak_at(addr)
 	if not addr then
 		addr = get_real_pc()
 	end
+	if break_targets[addr] then
+		emu:unhook(break_targets[addr])
+	end
 	break_targets[addr] = nil
-
-    if not next(break_targets) then
-        rmposttick(break_posttick)
-    end
 end
 
 function cont()
 	emu:set_paused(false)
 end
 
-function break_posttick()
-	local real_pc = get_real_pc()
-	local commands = break_targets[real_pc]
-	if commands then
-		emu:set_paused(true)
-		commands()
-	end
-end
-
 function printf(...)
 	print(string.format(...))
 end
@@ -144,6 +136,26 @@ emu:tick()      Execute one command.
 emu:shutdown()  Shutdown the emulator.
 emu:SetClockSp	Set emulator clock speed to certain times the original.
 eed(speed)
+emu:save_state	Save the whole machine state to a file.
+(path)
+emu:load_state	Restore a machine state saved by emu:save_state. Only states of
+(path)		the same model and ROM can be loaded.
+emu:cycles()    Number of cycles emulated since start.
+emu:record()    Start journaling all external input.
+emu:stop_recor	Stop journaling and write the journal to a file.
+ding(path)
+emu:replay(pat	Replay an input journal from its start.
+h)
+emu:rewind(cyc	Go back the given number of cycles in time.
+les)
+emu:set_speed(	Run at n times real time, 0 for as fast as possible.
+n)
+emu:speed()     Achieved emulated MHz and multiple of real time.
+emu:fast_forwa	Run as fast as possible until a target (cycles, pc, lcd,
+rd(target)	condition) is met, then pause.
+emu:hook(fn,op	Call fn(cycles, pc, elapsed) per instruction, every N
+tions)		cycles or per frame, optionally only at given PCs or while a
+		register has a value. Returns an id for emu:unhook(id).
 
 cpu.xxx         Get register value.
 cpu.bt          Current stack trace.
@@ -151,8 +163,15 @@ cpu.bt          Current stack trace.
 code            Access code. (By words, only use even address,
                 otherwise program will panic)
 data            Access data. (By bytes)
-data:watch      Set write watchpoint.
-data:rwatch     Set read watchpoint.
+data:watch      Set write watchpoint. fn(addr, old, new) is called
+                after the write.
+data:rwatch     Set read watchpoint. fn(addr, old, new) is called
+                after the read.
+data:watchpoin	Set native watchpoint (options: pause, log, count,
+t(addr,access,	value, mask, callback).
+options)
+data:watch_log	Logged watchpoint accesses.
+()
 
 power.bt        Battery voltage.
 power.sp        Solar panel voltage.
@@ -195,6 +214,7 @@ nrop            Next "ROP instruction".
 
 keyinj(file,pti	Short for Keyboard:KeyInject(filename,ptime,dtime).
 me,dtime)
+                   (ptime and dtime are milliseconds of emulated time)
 press(keycode)	Short for Keyboard:PressKey(keycode).
 relkey()        Short for Keyboard:ReleaseAll().
 keylog(file)	Short for Keyboard:StartKeyLog(filename).
@@ -708,9 +728,9 @@ function pbuf(x)
 	print(getscr(d))
 end
 
-local trace_handle, trace_last_pc = nil, nil
+local trace_handle, trace_last_pc, trace_hook = nil, nil, nil
 
-local function trace_posttick()
+local function trace_instruction()
 	local pc = get_real_pc()
 	if pc ~= trace_last_pc then
 		local indent = ('  '):rep(#cpu.bt:gsub('[^\n]',''))
@@ -735,7 +755,7 @@ function tr(filename)
 	end
 	trace_handle = io.open(filename or 'log', 'w')
 	trace_last_pc = nil
-	addposttick(trace_posttick)
+	trace_hook = emu:hook(trace_instruction, {every = 'instruction'})
 end
 
 function trs()
@@ -743,7 +763,7 @@ function trs()
 		print('Trace is not turned on')
 		return
 	end
-	rmposttick(trace_posttick)
+	emu:unhook(trace_hook)
 	trace_handle:close()
 	trace_handle = nil
 end
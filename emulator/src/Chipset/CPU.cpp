@@ -1,202 +1,204 @@
 #include "CPU.hpp"
 
 #include "../Emulator.hpp"
+#include "../Debugger.hpp"
 #include "Chipset.hpp"
 #include "MMU.hpp"
 #include "../Logger.hpp"
-#include "../Gui/ui.hpp"
-
+#include "../Data/StateArchive.hpp"
 #include <sstream>
 #include <iomanip>
 
 namespace casioemu
 {
-	CPU::OpcodeSource CPU::opcode_sources[] = {
-		//           function,                     hints, main mask, operand {size, mask, shift} x2
+	constexpr CPU::OpcodeSource CPU::opcode_sources[] = {
+		//           function,                     hints, main mask, operand {size, mask, shift} x2        , cycles
 		// * Arithmetic Instructions
-		{&CPU::OP_ADD        , H_WB                     , 0x8001, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_ADD        , H_WB                     , 0x1000, {{1, 0x000F,  8}, {0, 0x00FF,  0}}},
-		{&CPU::OP_ADD16      , H_WB                     , 0xF006, {{2, 0x000E,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_ADD16      , H_WB               | H_IE, 0xE080, {{2, 0x000E,  8}, {0, 0x007F,  0}}},
-		{&CPU::OP_ADDC       , H_WB                     , 0x8006, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_ADDC       , H_WB                     , 0x6000, {{1, 0x000F,  8}, {0, 0x00FF,  0}}},
-		{&CPU::OP_AND        , H_WB                     , 0x8002, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_AND        , H_WB                     , 0x2000, {{1, 0x000F,  8}, {0, 0x00FF,  0}}},
-		{&CPU::OP_SUB        ,                         0, 0x8007, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_SUB        ,                         0, 0x7000, {{1, 0x000F,  8}, {0, 0x00FF,  0}}},
-		{&CPU::OP_SUBC       ,                         0, 0x8005, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_SUBC       ,                         0, 0x5000, {{1, 0x000F,  8}, {0, 0x00FF,  0}}},
-		{&CPU::OP_MOV16      , H_WB                     , 0xF005, {{2, 0x000E,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_MOV16      , H_WB               | H_IE, 0xE000, {{2, 0x000E,  8}, {0, 0x007F,  0}}},
-		{&CPU::OP_MOV        , H_WB                     , 0x8000, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_MOV        , H_WB                     , 0x0000, {{1, 0x000F,  8}, {0, 0x00FF,  0}}},
-		{&CPU::OP_OR         , H_WB                     , 0x8003, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_OR         , H_WB                     , 0x3000, {{1, 0x000F,  8}, {0, 0x00FF,  0}}},
-		{&CPU::OP_XOR        , H_WB                     , 0x8004, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_XOR        , H_WB                     , 0x4000, {{1, 0x000F,  8}, {0, 0x00FF,  0}}},
-		{&CPU::OP_CMP16      ,                         0, 0xF007, {{2, 0x000E,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_SUB        , H_WB                     , 0x8008, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_SUBC       , H_WB                     , 0x8009, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
+		{&CPU::OP_ADD        , H_WB                     , 0x8001, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_ADD        , H_WB                     , 0x1000, {{1, 0x000F,  8}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_ADD16      , H_WB                     , 0xF006, {{2, 0x000E,  8}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_ADD16      , H_WB               | H_IE, 0xE080, {{2, 0x000E,  8}, {0, 0x007F,  0}},  2},
+		{&CPU::OP_ADDC       , H_WB                     , 0x8006, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_ADDC       , H_WB                     , 0x6000, {{1, 0x000F,  8}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_AND        , H_WB                     , 0x8002, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_AND        , H_WB                     , 0x2000, {{1, 0x000F,  8}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_SUB        ,                         0, 0x8007, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_SUB        ,                         0, 0x7000, {{1, 0x000F,  8}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_SUBC       ,                         0, 0x8005, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_SUBC       ,                         0, 0x5000, {{1, 0x000F,  8}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_MOV16      , H_WB                     , 0xF005, {{2, 0x000E,  8}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_MOV16      , H_WB               | H_IE, 0xE000, {{2, 0x000E,  8}, {0, 0x007F,  0}},  2},
+		{&CPU::OP_MOV        , H_WB                     , 0x8000, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_MOV        , H_WB                     , 0x0000, {{1, 0x000F,  8}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_OR         , H_WB                     , 0x8003, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_OR         , H_WB                     , 0x3000, {{1, 0x000F,  8}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_XOR        , H_WB                     , 0x8004, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_XOR        , H_WB                     , 0x4000, {{1, 0x000F,  8}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_CMP16      ,                         0, 0xF007, {{2, 0x000E,  8}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_SUB        , H_WB                     , 0x8008, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_SUBC       , H_WB                     , 0x8009, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
 		// * Shift Instructions
-		{&CPU::OP_SLL        , H_WB                     , 0x800A, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_SLL        , H_WB                     , 0x900A, {{1, 0x000F,  8}, {0, 0x0007,  4}}},
-		{&CPU::OP_SLLC       , H_WB                     , 0x800B, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_SLLC       , H_WB                     , 0x900B, {{1, 0x000F,  8}, {0, 0x0007,  4}}},
-		{&CPU::OP_SRA        , H_WB                     , 0x800E, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_SRA        , H_WB                     , 0x900E, {{1, 0x000F,  8}, {0, 0x0007,  4}}},
-		{&CPU::OP_SRL        , H_WB                     , 0x800C, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_SRL        , H_WB                     , 0x900C, {{1, 0x000F,  8}, {0, 0x0007,  4}}},
-		{&CPU::OP_SRLC       , H_WB                     , 0x800D, {{1, 0x000F,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_SRLC       , H_WB                     , 0x900D, {{1, 0x000F,  8}, {0, 0x0007,  4}}},
+		{&CPU::OP_SLL        , H_WB                     , 0x800A, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_SLL        , H_WB                     , 0x900A, {{1, 0x000F,  8}, {0, 0x0007,  4}},  1},
+		{&CPU::OP_SLLC       , H_WB                     , 0x800B, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_SLLC       , H_WB                     , 0x900B, {{1, 0x000F,  8}, {0, 0x0007,  4}},  1},
+		{&CPU::OP_SRA        , H_WB                     , 0x800E, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_SRA        , H_WB                     , 0x900E, {{1, 0x000F,  8}, {0, 0x0007,  4}},  1},
+		{&CPU::OP_SRL        , H_WB                     , 0x800C, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_SRL        , H_WB                     , 0x900C, {{1, 0x000F,  8}, {0, 0x0007,  4}},  1},
+		{&CPU::OP_SRLC       , H_WB                     , 0x800D, {{1, 0x000F,  8}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_SRLC       , H_WB                     , 0x900D, {{1, 0x000F,  8}, {0, 0x0007,  4}},  1},
 		// * Load/Store Instructions
-		{&CPU::OP_LS_EA      , 2 << 8                   , 0x9032, {{0, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 2 << 8 |      H_IA       , 0x9052, {{0, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_R       , 2 << 8                   , 0x9002, {{0, 0x000E,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_LS_I_R     , 2 << 8 |      H_TI       , 0xA008, {{0, 0x000E,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_LS_BP      , 2 << 8 |                0, 0xB000, {{0, 0x000E,  8}, {0, 0x003F,  0}}},
-		{&CPU::OP_LS_FP      , 2 << 8 |                0, 0xB040, {{0, 0x000E,  8}, {0, 0x003F,  0}}},
-		{&CPU::OP_LS_I       , 2 << 8 |      H_TI       , 0x9012, {{0, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 1 << 8                   , 0x9030, {{0, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 1 << 8 |      H_IA       , 0x9050, {{0, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_R       , 1 << 8                   , 0x9000, {{0, 0x000F,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_LS_I_R     , 1 << 8 |      H_TI       , 0x9008, {{0, 0x000F,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_LS_BP      , 1 << 8 |                0, 0xD000, {{0, 0x000F,  8}, {0, 0x003F,  0}}},
-		{&CPU::OP_LS_FP      , 1 << 8 |                0, 0xD040, {{0, 0x000F,  8}, {0, 0x003F,  0}}},
-		{&CPU::OP_LS_I       , 1 << 8 |      H_TI       , 0x9010, {{0, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 4 << 8                   , 0x9034, {{0, 0x000C,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 4 << 8 |      H_IA       , 0x9054, {{0, 0x000C,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 8 << 8                   , 0x9036, {{0, 0x0008,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 8 << 8 |      H_IA       , 0x9056, {{0, 0x0008,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 2 << 8 |             H_ST, 0x9033, {{0, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 2 << 8 |      H_IA | H_ST, 0x9053, {{0, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_R       , 2 << 8 |             H_ST, 0x9003, {{0, 0x000E,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_LS_I_R     , 2 << 8 |      H_TI | H_ST, 0xA009, {{0, 0x000E,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_LS_BP      , 2 << 8 |             H_ST, 0xB080, {{0, 0x000E,  8}, {0, 0x003F,  0}}},
-		{&CPU::OP_LS_FP      , 2 << 8 |             H_ST, 0xB0C0, {{0, 0x000E,  8}, {0, 0x003F,  0}}},
-		{&CPU::OP_LS_I       , 2 << 8 |      H_TI | H_ST, 0x9013, {{0, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 1 << 8 |             H_ST, 0x9031, {{0, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 1 << 8 |      H_IA | H_ST, 0x9051, {{0, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_R       , 1 << 8 |             H_ST, 0x9001, {{0, 0x000F,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_LS_I_R     , 1 << 8 |      H_TI | H_ST, 0x9009, {{0, 0x000F,  8}, {2, 0x000E,  4}}},
-		{&CPU::OP_LS_BP      , 1 << 8 |             H_ST, 0xD080, {{0, 0x000F,  8}, {0, 0x003F,  0}}},
-		{&CPU::OP_LS_FP      , 1 << 8 |             H_ST, 0xD0C0, {{0, 0x000F,  8}, {0, 0x003F,  0}}},
-		{&CPU::OP_LS_I       , 1 << 8 |      H_TI | H_ST, 0x9011, {{0, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 4 << 8 |             H_ST, 0x9035, {{0, 0x000C,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 4 << 8 |      H_IA | H_ST, 0x9055, {{0, 0x000C,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 8 << 8 |             H_ST, 0x9037, {{0, 0x0008,  8}, {0,      0,  0}}},
-		{&CPU::OP_LS_EA      , 8 << 8 |      H_IA | H_ST, 0x9057, {{0, 0x0008,  8}, {0,      0,  0}}},
+		{&CPU::OP_LS_EA      , 2 << 8                   , 0x9032, {{0, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_LS_EA      , 2 << 8 |      H_IA       , 0x9052, {{0, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_LS_R       , 2 << 8                   , 0x9002, {{0, 0x000E,  8}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_LS_I_R     , 2 << 8 |      H_TI       , 0xA008, {{0, 0x000E,  8}, {2, 0x000E,  4}},  3},
+		{&CPU::OP_LS_BP      , 2 << 8 |                0, 0xB000, {{0, 0x000E,  8}, {0, 0x003F,  0}},  3},
+		{&CPU::OP_LS_FP      , 2 << 8 |                0, 0xB040, {{0, 0x000E,  8}, {0, 0x003F,  0}},  3},
+		{&CPU::OP_LS_I       , 2 << 8 |      H_TI       , 0x9012, {{0, 0x000E,  8}, {0,      0,  0}},  3},
+		{&CPU::OP_LS_EA      , 1 << 8                   , 0x9030, {{0, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_LS_EA      , 1 << 8 |      H_IA       , 0x9050, {{0, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_LS_R       , 1 << 8                   , 0x9000, {{0, 0x000F,  8}, {2, 0x000E,  4}},  1},
+		{&CPU::OP_LS_I_R     , 1 << 8 |      H_TI       , 0x9008, {{0, 0x000F,  8}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_LS_BP      , 1 << 8 |                0, 0xD000, {{0, 0x000F,  8}, {0, 0x003F,  0}},  2},
+		{&CPU::OP_LS_FP      , 1 << 8 |                0, 0xD040, {{0, 0x000F,  8}, {0, 0x003F,  0}},  2},
+		{&CPU::OP_LS_I       , 1 << 8 |      H_TI       , 0x9010, {{0, 0x000F,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_LS_EA      , 4 << 8                   , 0x9034, {{0, 0x000C,  8}, {0,      0,  0}},  4},
+		{&CPU::OP_LS_EA      , 4 << 8 |      H_IA       , 0x9054, {{0, 0x000C,  8}, {0,      0,  0}},  4},
+		{&CPU::OP_LS_EA      , 8 << 8                   , 0x9036, {{0, 0x0008,  8}, {0,      0,  0}},  8},
+		{&CPU::OP_LS_EA      , 8 << 8 |      H_IA       , 0x9056, {{0, 0x0008,  8}, {0,      0,  0}},  8},
+		{&CPU::OP_LS_EA      , 2 << 8 |             H_ST, 0x9033, {{0, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_LS_EA      , 2 << 8 |      H_IA | H_ST, 0x9053, {{0, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_LS_R       , 2 << 8 |             H_ST, 0x9003, {{0, 0x000E,  8}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_LS_I_R     , 2 << 8 |      H_TI | H_ST, 0xA009, {{0, 0x000E,  8}, {2, 0x000E,  4}},  3},
+		{&CPU::OP_LS_BP      , 2 << 8 |             H_ST, 0xB080, {{0, 0x000E,  8}, {0, 0x003F,  0}},  3},
+		{&CPU::OP_LS_FP      , 2 << 8 |             H_ST, 0xB0C0, {{0, 0x000E,  8}, {0, 0x003F,  0}},  3},
+		{&CPU::OP_LS_I       , 2 << 8 |      H_TI | H_ST, 0x9013, {{0, 0x000E,  8}, {0,      0,  0}},  3},
+		{&CPU::OP_LS_EA      , 1 << 8 |             H_ST, 0x9031, {{0, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_LS_EA      , 1 << 8 |      H_IA | H_ST, 0x9051, {{0, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_LS_R       , 1 << 8 |             H_ST, 0x9001, {{0, 0x000F,  8}, {2, 0x000E,  4}},  1},
+		{&CPU::OP_LS_I_R     , 1 << 8 |      H_TI | H_ST, 0x9009, {{0, 0x000F,  8}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_LS_BP      , 1 << 8 |             H_ST, 0xD080, {{0, 0x000F,  8}, {0, 0x003F,  0}},  2},
+		{&CPU::OP_LS_FP      , 1 << 8 |             H_ST, 0xD0C0, {{0, 0x000F,  8}, {0, 0x003F,  0}},  2},
+		{&CPU::OP_LS_I       , 1 << 8 |      H_TI | H_ST, 0x9011, {{0, 0x000F,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_LS_EA      , 4 << 8 |             H_ST, 0x9035, {{0, 0x000C,  8}, {0,      0,  0}},  4},
+		{&CPU::OP_LS_EA      , 4 << 8 |      H_IA | H_ST, 0x9055, {{0, 0x000C,  8}, {0,      0,  0}},  4},
+		{&CPU::OP_LS_EA      , 8 << 8 |             H_ST, 0x9037, {{0, 0x0008,  8}, {0,      0,  0}},  8},
+		{&CPU::OP_LS_EA      , 8 << 8 |      H_IA | H_ST, 0x9057, {{0, 0x0008,  8}, {0,      0,  0}},  8},
 		// * Control Register Access Instructions
-		{&CPU::OP_ADDSP      ,                         0, 0xE100, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_CTRL       ,                    1 << 8, 0xA00F, {{0,      0,  0}, {1, 0x000F,  4}}},
-		{&CPU::OP_CTRL       ,                    2 << 8, 0xA00D, {{0,      0,  0}, {2, 0x000E,  8}}},
-		{&CPU::OP_CTRL       ,                    3 << 8, 0xA00C, {{0,      0,  0}, {1, 0x000F,  4}}},
-		{&CPU::OP_CTRL       , H_WB            |  4 << 8, 0xA005, {{2, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_CTRL       , H_WB            |  5 << 8, 0xA01A, {{2, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_CTRL       ,                    6 << 8, 0xA00B, {{0,      0,  0}, {1, 0x000F,  4}}},
-		{&CPU::OP_CTRL       ,                    7 << 8, 0xE900, {{0,      0,  0}, {0, 0x00FF,  0}}},
-		{&CPU::OP_CTRL       , H_WB            |  8 << 8, 0xA007, {{1, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_CTRL       , H_WB            |  9 << 8, 0xA004, {{1, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_CTRL       , H_WB            | 10 << 8, 0xA003, {{1, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_CTRL       ,                   11 << 8, 0xA10A, {{0,      0,  0}, {2, 0x000E,  4}}},
+		{&CPU::OP_ADDSP      ,                         0, 0xE100, {{0, 0x00FF,  0}, {0,      0,  0}},  2},
+		{&CPU::OP_CTRL       ,                    1 << 8, 0xA00F, {{0,      0,  0}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_CTRL       ,                    2 << 8, 0xA00D, {{0,      0,  0}, {2, 0x000E,  8}},  2},
+		{&CPU::OP_CTRL       ,                    3 << 8, 0xA00C, {{0,      0,  0}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_CTRL       , H_WB            |  4 << 8, 0xA005, {{2, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_CTRL       , H_WB            |  5 << 8, 0xA01A, {{2, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_CTRL       ,                    6 << 8, 0xA00B, {{0,      0,  0}, {1, 0x000F,  4}},  1},
+		{&CPU::OP_CTRL       ,                    7 << 8, 0xE900, {{0,      0,  0}, {0, 0x00FF,  0}},  1},
+		{&CPU::OP_CTRL       , H_WB            |  8 << 8, 0xA007, {{1, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_CTRL       , H_WB            |  9 << 8, 0xA004, {{1, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_CTRL       , H_WB            | 10 << 8, 0xA003, {{1, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_CTRL       ,                   11 << 8, 0xA10A, {{0,      0,  0}, {2, 0x000E,  4}},  2},
 		// * PUSH/POP Instructions
-		{&CPU::OP_PUSH       ,                         0, 0xF05E, {{0,      0,  0}, {2, 0x000E,  8}}},
-		{&CPU::OP_PUSH       ,                         0, 0xF07E, {{0,      0,  0}, {8, 0x0008,  8}}},
-		{&CPU::OP_PUSH       ,                         0, 0xF04E, {{0,      0,  0}, {1, 0x000F,  8}}},
-		{&CPU::OP_PUSH       ,                         0, 0xF06E, {{0,      0,  0}, {4, 0x000C,  8}}},
-		{&CPU::OP_PUSHL      ,                         0, 0xF0CE, {{0,      0,  0}, {0, 0x000F,  8}}},
-		{&CPU::OP_POP        , H_WB                     , 0xF01E, {{2, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_POP        , H_WB                     , 0xF03E, {{8, 0x0008,  8}, {0,      0,  0}}},
-		{&CPU::OP_POP        , H_WB                     , 0xF00E, {{1, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_POP        , H_WB                     , 0xF02E, {{4, 0x000C,  8}, {0,      0,  0}}},
-		{&CPU::OP_POPL       ,                         0, 0xF08E, {{0, 0x000F,  8}, {0,      0,  0}}},
+		{&CPU::OP_PUSH       ,                         0, 0xF05E, {{0,      0,  0}, {2, 0x000E,  8}},  2},
+		{&CPU::OP_PUSH       ,                         0, 0xF07E, {{0,      0,  0}, {8, 0x0008,  8}},  8},
+		{&CPU::OP_PUSH       ,                         0, 0xF04E, {{0,      0,  0}, {1, 0x000F,  8}},  1},
+		{&CPU::OP_PUSH       ,                         0, 0xF06E, {{0,      0,  0}, {4, 0x000C,  8}},  4},
+		{&CPU::OP_PUSHL      ,                         0, 0xF0CE, {{0,      0,  0}, {0, 0x000F,  8}},  1},
+		{&CPU::OP_POP        , H_WB                     , 0xF01E, {{2, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_POP        , H_WB                     , 0xF03E, {{8, 0x0008,  8}, {0,      0,  0}},  8},
+		{&CPU::OP_POP        , H_WB                     , 0xF00E, {{1, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_POP        , H_WB                     , 0xF02E, {{4, 0x000C,  8}, {0,      0,  0}},  4},
+		{&CPU::OP_POPL       ,                         0, 0xF08E, {{0, 0x000F,  8}, {0,      0,  0}},  1},
 		// * Coprocessor Data Transfer Instructions
-		{&CPU::OP_CR_R       ,                         0, 0xA00E, {{0, 0x000F,  8}, {0, 0x000F,  4}}},
-		{&CPU::OP_CR_EA      ,      2 << 8 |           0, 0xF02D, {{0,      0,  0}, {0, 0x000E,  8}}},
-		{&CPU::OP_CR_EA      ,      2 << 8 | H_IA       , 0xF03D, {{0,      0,  0}, {0, 0x000E,  8}}},
-		{&CPU::OP_CR_EA      ,      1 << 8 |           0, 0xF00D, {{0,      0,  0}, {0, 0x000F,  8}}},
-		{&CPU::OP_CR_EA      ,      1 << 8 | H_IA       , 0xF01D, {{0,      0,  0}, {0, 0x000F,  8}}},
-		{&CPU::OP_CR_EA      ,      4 << 8 |           0, 0xF04D, {{0,      0,  0}, {0, 0x000C,  8}}},
-		{&CPU::OP_CR_EA      ,      4 << 8 | H_IA       , 0xF05D, {{0,      0,  0}, {0, 0x000C,  8}}},
-		{&CPU::OP_CR_EA      ,      8 << 8 |           0, 0xF06D, {{0,      0,  0}, {0, 0x0008,  8}}},
-		{&CPU::OP_CR_EA      ,      8 << 8 | H_IA       , 0xF07D, {{0,      0,  0}, {0, 0x0008,  8}}},
-		{&CPU::OP_CR_R       ,                      H_ST, 0xA006, {{0, 0x000F,  8}, {0, 0x000F,  4}}},
-		{&CPU::OP_CR_EA      ,      2 << 8 |        H_ST, 0xF0AD, {{0, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_CR_EA      ,      2 << 8 | H_IA | H_ST, 0xF0BD, {{0, 0x000E,  8}, {0,      0,  0}}},
-		{&CPU::OP_CR_EA      ,      1 << 8 |        H_ST, 0xF08D, {{0, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_CR_EA      ,      1 << 8 | H_IA | H_ST, 0xF09D, {{0, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_CR_EA      ,      4 << 8 |        H_ST, 0xF0CD, {{0, 0x000C,  8}, {0,      0,  0}}},
-		{&CPU::OP_CR_EA      ,      4 << 8 | H_IA | H_ST, 0xF0DD, {{0, 0x000C,  8}, {0,      0,  0}}},
-		{&CPU::OP_CR_EA      ,      8 << 8 |        H_ST, 0xF0ED, {{0, 0x0008,  8}, {0,      0,  0}}},
-		{&CPU::OP_CR_EA      ,      8 << 8 | H_IA | H_ST, 0xF0FD, {{0, 0x0008,  8}, {0,      0,  0}}},
+		{&CPU::OP_CR_R       ,                         0, 0xA00E, {{0, 0x000F,  8}, {0, 0x000F,  4}},  1},
+		{&CPU::OP_CR_EA      ,      2 << 8 |           0, 0xF02D, {{0,      0,  0}, {0, 0x000E,  8}},  2},
+		{&CPU::OP_CR_EA      ,      2 << 8 | H_IA       , 0xF03D, {{0,      0,  0}, {0, 0x000E,  8}},  2},
+		{&CPU::OP_CR_EA      ,      1 << 8 |           0, 0xF00D, {{0,      0,  0}, {0, 0x000F,  8}},  1},
+		{&CPU::OP_CR_EA      ,      1 << 8 | H_IA       , 0xF01D, {{0,      0,  0}, {0, 0x000F,  8}},  1},
+		{&CPU::OP_CR_EA      ,      4 << 8 |           0, 0xF04D, {{0,      0,  0}, {0, 0x000C,  8}},  4},
+		{&CPU::OP_CR_EA      ,      4 << 8 | H_IA       , 0xF05D, {{0,      0,  0}, {0, 0x000C,  8}},  4},
+		{&CPU::OP_CR_EA      ,      8 << 8 |           0, 0xF06D, {{0,      0,  0}, {0, 0x0008,  8}},  8},
+		{&CPU::OP_CR_EA      ,      8 << 8 | H_IA       , 0xF07D, {{0,      0,  0}, {0, 0x0008,  8}},  8},
+		{&CPU::OP_CR_R       ,                      H_ST, 0xA006, {{0, 0x000F,  8}, {0, 0x000F,  4}},  1},
+		{&CPU::OP_CR_EA      ,      2 << 8 |        H_ST, 0xF0AD, {{0, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_CR_EA      ,      2 << 8 | H_IA | H_ST, 0xF0BD, {{0, 0x000E,  8}, {0,      0,  0}},  2},
+		{&CPU::OP_CR_EA      ,      1 << 8 |        H_ST, 0xF08D, {{0, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_CR_EA      ,      1 << 8 | H_IA | H_ST, 0xF09D, {{0, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_CR_EA      ,      4 << 8 |        H_ST, 0xF0CD, {{0, 0x000C,  8}, {0,      0,  0}},  4},
+		{&CPU::OP_CR_EA      ,      4 << 8 | H_IA | H_ST, 0xF0DD, {{0, 0x000C,  8}, {0,      0,  0}},  4},
+		{&CPU::OP_CR_EA      ,      8 << 8 |        H_ST, 0xF0ED, {{0, 0x0008,  8}, {0,      0,  0}},  8},
+		{&CPU::OP_CR_EA      ,      8 << 8 | H_IA | H_ST, 0xF0FD, {{0, 0x0008,  8}, {0,      0,  0}},  8},
 		// * EA Register Data Transfer Instructions
-		{&CPU::OP_LEA        ,                         0, 0xF00A, {{0,      0,  0}, {2, 0x000E,  4}}},
-		{&CPU::OP_LEA        ,        H_TI              , 0xF00B, {{0,      0,  0}, {2, 0x000E,  4}}},
-		{&CPU::OP_LEA        ,        H_TI              , 0xF00C, {{0,      0,  0}, {0,      0,  0}}},
+		{&CPU::OP_LEA        ,                         0, 0xF00A, {{0,      0,  0}, {2, 0x000E,  4}},  1},
+		{&CPU::OP_LEA        ,        H_TI              , 0xF00B, {{0,      0,  0}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_LEA        ,        H_TI              , 0xF00C, {{0,      0,  0}, {0,      0,  0}},  2},
 		// * ALU Instructions
-		{&CPU::OP_DAA        , H_WB                     , 0x801F, {{1, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_DAS        , H_WB                     , 0x803F, {{1, 0x000F,  8}, {0,      0,  0}}},
-		{&CPU::OP_NEG        , H_WB                     , 0x805F, {{1, 0x000F,  8}, {0,      0,  0}}},
+		{&CPU::OP_DAA        , H_WB                     , 0x801F, {{1, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_DAS        , H_WB                     , 0x803F, {{1, 0x000F,  8}, {0,      0,  0}},  1},
+		{&CPU::OP_NEG        , H_WB                     , 0x805F, {{1, 0x000F,  8}, {0,      0,  0}},  1},
 		// * Bit Access Instructions
-		{&CPU::OP_BITMOD     ,                         0, 0xA000, {{0, 0x000F,  8}, {0, 0x0007,  4}}},
-		{&CPU::OP_BITMOD     ,        H_TI              , 0xA080, {{0,      0,  0}, {0, 0x0007,  4}}},
-		{&CPU::OP_BITMOD     ,                         0, 0xA002, {{0, 0x000F,  8}, {0, 0x0007,  4}}},
-		{&CPU::OP_BITMOD     ,        H_TI              , 0xA082, {{0,      0,  0}, {0, 0x0007,  4}}},
-		{&CPU::OP_BITMOD     ,                         0, 0xA001, {{0, 0x000F,  8}, {0, 0x0007,  4}}},
-		{&CPU::OP_BITMOD     ,        H_TI              , 0xA081, {{0,      0,  0}, {0, 0x0007,  4}}},
+		{&CPU::OP_BITMOD     ,                         0, 0xA000, {{0, 0x000F,  8}, {0, 0x0007,  4}},  1},
+		{&CPU::OP_BITMOD     ,        H_TI              , 0xA080, {{0,      0,  0}, {0, 0x0007,  4}},  3},
+		{&CPU::OP_BITMOD     ,                         0, 0xA002, {{0, 0x000F,  8}, {0, 0x0007,  4}},  1},
+		{&CPU::OP_BITMOD     ,        H_TI              , 0xA082, {{0,      0,  0}, {0, 0x0007,  4}},  3},
+		{&CPU::OP_BITMOD     ,                         0, 0xA001, {{0, 0x000F,  8}, {0, 0x0007,  4}},  1},
+		{&CPU::OP_BITMOD     ,        H_TI              , 0xA081, {{0,      0,  0}, {0, 0x0007,  4}},  2},
 		// * PSW Access Instructions
-		{&CPU::OP_PSW_OR     ,                         0, 0xED08, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_PSW_AND    ,                         0, 0xEBF7, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_PSW_OR     ,                         0, 0xED80, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_PSW_AND    ,                         0, 0xEB7F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_CPLC       ,                         0, 0xFECF, {{0,      0,  0}, {0,      0,  0}}},
+		{&CPU::OP_PSW_OR     ,                         0, 0xED08, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_PSW_AND    ,                         0, 0xEBF7, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_PSW_OR     ,                         0, 0xED80, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_PSW_AND    ,                         0, 0xEB7F, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_CPLC       ,                         0, 0xFECF, {{0,      0,  0}, {0,      0,  0}},  1},
 		// * Conditional Relative Branch Instructions
-		{&CPU::OP_BC         ,                         0, 0xC000, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC100, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC200, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC300, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC400, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC500, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC600, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC700, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC800, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xC900, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xCA00, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xCB00, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xCC00, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xCD00, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BC         ,                         0, 0xCE00, {{0, 0x00FF,  0}, {0,      0,  0}}},
+		{&CPU::OP_BC         ,                         0, 0xC000, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC100, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC200, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC300, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC400, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC500, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC600, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC700, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC800, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xC900, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xCA00, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xCB00, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xCC00, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xCD00, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_BC         ,                         0, 0xCE00, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
 		// * Sign Extension Instruction
-		{&CPU::OP_EXTBW      ,                         0, 0x810F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_EXTBW      ,                         0, 0x832F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_EXTBW      ,                         0, 0x854F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_EXTBW      ,                         0, 0x876F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_EXTBW      ,                         0, 0x898F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_EXTBW      ,                         0, 0x8BAF, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_EXTBW      ,                         0, 0x8DCF, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_EXTBW      ,                         0, 0x8FEF, {{0,      0,  0}, {0,      0,  0}}},
+		{&CPU::OP_EXTBW      ,                         0, 0x810F, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_EXTBW      ,                         0, 0x832F, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_EXTBW      ,                         0, 0x854F, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_EXTBW      ,                         0, 0x876F, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_EXTBW      ,                         0, 0x898F, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_EXTBW      ,                         0, 0x8BAF, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_EXTBW      ,                         0, 0x8DCF, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_EXTBW      ,                         0, 0x8FEF, {{0,      0,  0}, {0,      0,  0}},  1},
 		// * Software Interrupt Instructions
-		{&CPU::OP_SWI        ,                         0, 0xE500, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_BRK        ,                         0, 0xFFFF, {{0,      0,  0}, {0,      0,  0}}},
+		{&CPU::OP_SWI        ,                         0, 0xE500, {{0, 0x00FF,  0}, {0,      0,  0}},  3},
+		{&CPU::OP_BRK        ,                         0, 0xFFFF, {{0,      0,  0}, {0,      0,  0}},  3},
 		// * Branch Instructions
-		{&CPU::OP_B          ,        H_TI              , 0xF000, {{0,      0,  0}, {0, 0x000F,  8}}},
-		{&CPU::OP_B          ,                         0, 0xF002, {{0,      0,  0}, {2, 0x000E,  4}}},
-		{&CPU::OP_BL         ,        H_TI              , 0xF001, {{0,      0,  0}, {0, 0x000F,  8}}},
-		{&CPU::OP_BL         ,                         0, 0xF003, {{0,      0,  0}, {2, 0x000E,  4}}},
+		{&CPU::OP_B          ,        H_TI              , 0xF000, {{0,      0,  0}, {0, 0x000F,  8}},  2},
+		{&CPU::OP_B          ,                         0, 0xF002, {{0,      0,  0}, {2, 0x000E,  4}},  2},
+		{&CPU::OP_BL         ,        H_TI              , 0xF001, {{0,      0,  0}, {0, 0x000F,  8}},  2},
+		{&CPU::OP_BL         ,                         0, 0xF003, {{0,      0,  0}, {2, 0x000E,  4}},  2},
 		// * Multiplication and Division Instructions
-		{&CPU::OP_MUL        , H_WB                     , 0xF004, {{2, 0x000E,  8}, {1, 0x000F,  4}}},
-		{&CPU::OP_DIV        , H_WB                     , 0xF009, {{2, 0x000E,  8}, {1, 0x000F,  4}}},
+		{&CPU::OP_MUL        , H_WB                     , 0xF004, {{2, 0x000E,  8}, {1, 0x000F,  4}},  9},
+		{&CPU::OP_DIV        , H_WB                     , 0xF009, {{2, 0x000E,  8}, {1, 0x000F,  4}}, 17},
 		// * Miscellaneous Instructions
-		{&CPU::OP_INC_EA     ,                         0, 0xFE2F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_DEC_EA     ,                         0, 0xFE3F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_RT         ,                         0, 0xFE1F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_RTI        ,                         0, 0xFE0F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_NOP        ,                         0, 0xFE8F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_DSR        ,               H_DS       , 0xFE9F, {{0,      0,  0}, {0,      0,  0}}},
-		{&CPU::OP_DSR        ,               H_DS | H_DW, 0xE300, {{0, 0x00FF,  0}, {0,      0,  0}}},
-		{&CPU::OP_DSR        ,               H_DS | H_DW, 0x900F, {{1, 0x000F,  4}, {0,      0,  0}}}
+		{&CPU::OP_INC_EA     ,                         0, 0xFE2F, {{0,      0,  0}, {0,      0,  0}},  2},
+		{&CPU::OP_DEC_EA     ,                         0, 0xFE3F, {{0,      0,  0}, {0,      0,  0}},  2},
+		{&CPU::OP_RT         ,                         0, 0xFE1F, {{0,      0,  0}, {0,      0,  0}},  2},
+		{&CPU::OP_RTI        ,                         0, 0xFE0F, {{0,      0,  0}, {0,      0,  0}},  2},
+		{&CPU::OP_NOP        ,                         0, 0xFE8F, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_DSR        ,               H_DS       , 0xFE9F, {{0,      0,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_DSR        ,               H_DS | H_DW, 0xE300, {{0, 0x00FF,  0}, {0,      0,  0}},  1},
+		{&CPU::OP_DSR        ,               H_DS | H_DW, 0x900F, {{1, 0x000F,  4}, {0,      0,  0}},  1}
 	};
 
-	CPU::RegisterRecord CPU::register_record_sources[] = {
+	constexpr size_t CPU::opcode_source_count = sizeof(opcode_sources) / sizeof(opcode_sources[0]);
+
+	const CPU::RegisterRecord CPU::register_record_sources[] = {
 		{    "r", 16, 0, nullptr,    (RegisterStubArrayPointer)&CPU::reg_r},
 		{   "cr", 16, 0, nullptr,   (RegisterStubArrayPointer)&CPU::reg_cr},
 		{   "pc",  1, 0,        (RegisterStubPointer)&CPU::reg_pc, nullptr},
@@ -233,19 +235,11 @@ namespace casioemu
 
 	CPU::CPU(Emulator &_emulator) : emulator(_emulator), reg_lr(reg_elr[0]), reg_lcsr(reg_ecsr[0]), reg_psw(reg_epsw[0])
 	{
-		opcode_dispatch = new OpcodeSource *[0x10000];
-		for (size_t ix = 0; ix != 0x10000; ++ix)
-			opcode_dispatch[ix] = nullptr;
-	}
-
-	CPU::~CPU()
-	{
-		delete[] opcode_dispatch;
+		opcode_dispatch = SharedOpcodeDispatch();
 	}
 
 	void CPU::SetupInternals()
 	{
-		SetupOpcodeDispatch();
 		SetupRegisterProxies();
 
 		impl_csr_mask = emulator.GetModelInfo("csr_mask");
@@ -255,14 +249,26 @@ namespace casioemu
 		dsr_mask = emulator.hardware_id == HW_CLASSWIZ ? 0x1F : 0xFF;
 
 		fetch_addition = 2;
+
+		decode_cache.resize((emulator.chipset.rom_data->size() + 0xFFFF) >> 16);
+		translate_blocks = emulator.argv_map.find("translate_blocks") != emulator.argv_map.end();
+		native_blocks = true;
+		code_chunk_used = 0;
+	}
+
+	const CPU::OpcodeSource *const *CPU::SharedOpcodeDispatch()
+	{
+		static const std::unique_ptr<const OpcodeSource *[]> shared_dispatch = BuildOpcodeDispatch();
+		return shared_dispatch.get();
 	}
 
-	void CPU::SetupOpcodeDispatch()
+	std::unique_ptr<const CPU::OpcodeSource *[]> CPU::BuildOpcodeDispatch()
 	{
+		std::unique_ptr<const OpcodeSource *[]> opcode_dispatch(new const OpcodeSource *[0x10000]());
 		uint16_t *permutation_buffer = new uint16_t[0x10000];
-		for (size_t ix = 0; ix != sizeof(opcode_sources) / sizeof(opcode_sources[0]); ++ix)
+		for (size_t ix = 0; ix != opcode_source_count; ++ix)
 		{
-			OpcodeSource &handler_stub = opcode_sources[ix];
+			const OpcodeSource &handler_stub = opcode_sources[ix];
 
 			uint16_t varying_bits = 0;
 			for (size_t ox = 0; ox != sizeof(impl_operands) / sizeof(impl_operands[0]); ++ox)
@@ -288,13 +294,14 @@ namespace casioemu
 			}
 		}
 		delete[] permutation_buffer;
+		return opcode_dispatch;
 	}
 
 	void CPU::SetupRegisterProxies()
 	{
 		for (size_t ix = 0; ix != sizeof(register_record_sources) / sizeof(register_record_sources[0]); ++ix)
 		{
-			RegisterRecord &record = register_record_sources[ix];
+			const RegisterRecord &record = register_record_sources[ix];
 
 			if (record.stub)
 			{
@@ -348,14 +355,13 @@ namespace casioemu
 		lua_setfield(emulator.lua_state, -2, "__index");
 		lua_pushcfunction(emulator.lua_state, [](lua_State *lua_state) {
 			CPU *cpu = *(CPU **)lua_topointer(lua_state, 1);
-			auto it = cpu->register_proxies.find(lua_tostring(lua_state, 2));
-			if (it == cpu->register_proxies.end())
+			std::string index = lua_tostring(lua_state, 2);
+			if (cpu->register_proxies.find(index) == cpu->register_proxies.end())
 				return 0;
-			RegisterStub *reg_stub = it->second;
-			if (reg_stub->type_size == 1)
-				reg_stub->raw = (uint8_t)lua_tointeger(lua_state, 3);
-			else
-				reg_stub->raw = (uint16_t)lua_tointeger(lua_state, 3);
+			Emulator::InputEvent input(Emulator::InputEvent::IE_WRITE_REGISTER);
+			input.data.assign(index.begin(), index.end());
+			input.value = (uint16_t)lua_tointeger(lua_state, 3);
+			cpu->emulator.Input(input);
 			return 0;
 		});
 		lua_setfield(emulator.lua_state, -2, "__newindex");
@@ -363,6 +369,29 @@ namespace casioemu
 		lua_setglobal(emulator.lua_state, "cpu");
 	}
 
+	bool CPU::SetRegister(const std::string &name, uint16_t value)
+	{
+		auto it = register_proxies.find(name);
+		if (it == register_proxies.end())
+			return false;
+		RegisterStub *reg_stub = it->second;
+		if (reg_stub->type_size == 1)
+			reg_stub->raw = (uint8_t)value;
+		else
+			reg_stub->raw = value;
+		return true;
+	}
+
+	bool CPU::FindRegister(const std::string &name, const uint16_t *&raw, uint16_t &mask)
+	{
+		auto it = register_proxies.find(name);
+		if (it == register_proxies.end())
+			return false;
+		raw = &it->second->raw;
+		mask = it->second->type_size == 1 ? 0xFF : 0xFFFF;
+		return true;
+	}
+
 	uint16_t CPU::Fetch()
 	{
 		if (reg_csr.raw & ~impl_csr_mask)
@@ -375,44 +404,148 @@ namespace casioemu
 		return opcode;
 	}
 
-	void CPU::Next()
+	void CPU::DecodeAt(DecodedInstruction &decoded, uint16_t opcode)
+	{
+		decoded.handler = opcode_dispatch[opcode];
+		decoded.opcode = opcode;
+		decoded.long_imm = 0;
+		if (!decoded.handler)
+			return;
+
+		decoded.row = decoded.handler - opcode_sources;
+		for (size_t ix = 0; ix != sizeof(impl_operands) / sizeof(impl_operands[0]); ++ix)
+			decoded.operand_fields[ix] = (opcode >> decoded.handler->operands[ix].shift) & decoded.handler->operands[ix].mask;
+	}
+
+	CPU::DecodedInstruction &CPU::CachedDecode(size_t offset)
+	{
+		std::unique_ptr<DecodedInstruction[]> &segment = decode_cache[offset >> 16];
+		if (!segment)
+		{
+			segment.reset(new DecodedInstruction[0x8000]);
+			for (size_t ix = 0; ix != 0x8000; ++ix)
+				segment[ix].handler = nullptr;
+		}
+
+		DecodedInstruction &decoded = segment[(offset & 0xFFFF) >> 1];
+		if (!decoded.handler)
+		{
+			DecodeAt(decoded, emulator.chipset.mmu.ReadCode(offset));
+			if (decoded.handler && decoded.handler->hint & H_TI)
+				decoded.long_imm = emulator.chipset.mmu.ReadCode((offset & ~0xFFFF) | (uint16_t)(offset + 2));
+		}
+		return decoded;
+	}
+
+	const CPU::DecodedInstruction *CPU::Decode()
 	{
+		if (reg_csr.raw & ~impl_csr_mask)
+			reg_csr.raw &= impl_csr_mask;
+		if (reg_pc.raw & 1)
+			reg_pc.raw &= ~1;
+
+		size_t offset = (reg_csr.raw << 16) | reg_pc.raw;
 		/**
-		 * `reg_dsr` only affects the current instruction. The old DSR is stored in
-		 * `impl_last_dsr` and is recalled every time a DSR instruction is encountered
-		 * that activates DSR addressing without actually changing DSR.
+		 * A pending `CorruptByDSR` changes how far PC moves after this fetch,
+		 * and code outside ROM is not worth caching. Both go the slow way.
 		 */
-		reg_dsr	= 0;
-
-		emulator.chipset.isMIBlocked = false;
+		if (fetch_addition != 2 || offset >= emulator.chipset.rom_data->size())
+		{
+			DecodeAt(decode_scratch, Fetch());
+			if (!decode_scratch.handler)
+				return nullptr;
+			if (decode_scratch.handler->hint & H_TI)
+				decode_scratch.long_imm = Fetch();
+			return &decode_scratch;
+		}
 
-		while (1)
+		DecodedInstruction &decoded = CachedDecode(offset);
+		if (!decoded.handler)
 		{
-			impl_opcode = Fetch();
-			OpcodeSource *handler = opcode_dispatch[impl_opcode];
+			reg_pc.raw = (uint16_t)(reg_pc.raw + 2);
+			return nullptr;
+		}
 
-			if (!handler)
-				continue;
+		reg_pc.raw = (uint16_t)(reg_pc.raw + (decoded.handler->hint & H_TI ? 4 : 2));
+		return &decoded;
+	}
 
-			impl_long_imm = 0;
-			if (handler->hint & H_TI)
-				impl_long_imm = Fetch();
+	template<size_t register_size>
+	void CPU::LoadOperand(size_t index, uint16_t field)
+	{
+		impl_operands[index].value = field;
+		impl_operands[index].register_index = field;
+		impl_operands[index].register_size = register_size;
 
-			for (size_t ix = 0; ix != sizeof(impl_operands) / sizeof(impl_operands[0]); ++ix)
-			{
-				impl_operands[ix].value = (impl_opcode >> handler->operands[ix].shift) & handler->operands[ix].mask;
-				impl_operands[ix].register_index = impl_operands[ix].value;
-				impl_operands[ix].register_size = handler->operands[ix].register_size;
+		if constexpr (register_size != 0)
+		{
+			impl_operands[index].value = 0;
+			for (size_t bx = 0; bx != register_size; ++bx)
+				impl_operands[index].value |= (uint64_t)(reg_r[field + bx]) << (bx * 8);
+		}
+	}
 
-				if (impl_operands[ix].register_size)
-				{
-					impl_operands[ix].value = 0;
-					for (size_t bx = 0; bx != impl_operands[ix].register_size; ++bx)
-						impl_operands[ix].value |= (uint64_t)(reg_r[impl_operands[ix].register_index + bx]) << (bx * 8);
-				}
-			}
-			impl_hint = handler->hint;
+	/**
+	 * Handlers that never look at `impl_flags_in` nor touch `impl_flags_changed`
+	 * and `impl_flags_out` (some of them write `reg_psw` directly, which the merge
+	 * would leave alone anyway). Stores share their handlers with loads, but only
+	 * loads go through `ZSCheck`.
+	 */
+	constexpr bool CPU::ChangesFlags(const OpcodeSource &source)
+	{
+		auto handler_function = source.handler_function;
+		if (handler_function == &CPU::OP_LS_EA || handler_function == &CPU::OP_LS_R ||
+				handler_function == &CPU::OP_LS_I_R || handler_function == &CPU::OP_LS_BP ||
+				handler_function == &CPU::OP_LS_FP || handler_function == &CPU::OP_LS_I)
+			return !(source.hint & H_ST);
+
+		return !(handler_function == &CPU::OP_ADDSP || handler_function == &CPU::OP_CTRL ||
+				handler_function == &CPU::OP_PUSH || handler_function == &CPU::OP_PUSHL ||
+				handler_function == &CPU::OP_POP || handler_function == &CPU::OP_POPL ||
+				handler_function == &CPU::OP_CR_R || handler_function == &CPU::OP_CR_EA ||
+				handler_function == &CPU::OP_LEA || handler_function == &CPU::OP_PSW_OR ||
+				handler_function == &CPU::OP_PSW_AND || handler_function == &CPU::OP_CPLC ||
+				handler_function == &CPU::OP_SWI || handler_function == &CPU::OP_BRK ||
+				handler_function == &CPU::OP_B || handler_function == &CPU::OP_BL ||
+				handler_function == &CPU::OP_RT || handler_function == &CPU::OP_RTI ||
+				handler_function == &CPU::OP_NOP || handler_function == &CPU::OP_DSR);
+	}
 
+	/**
+	 * Number of bytes an instruction moves over the data bus, which decides
+	 * how many wait cycles it takes if DSR points outside segment 0.
+	 */
+	constexpr size_t CPU::DataBytes(const OpcodeSource &source)
+	{
+		auto handler_function = source.handler_function;
+		if (handler_function == &CPU::OP_LS_EA || handler_function == &CPU::OP_LS_R ||
+				handler_function == &CPU::OP_LS_I_R || handler_function == &CPU::OP_LS_BP ||
+				handler_function == &CPU::OP_LS_FP || handler_function == &CPU::OP_LS_I ||
+				handler_function == &CPU::OP_CR_EA)
+			return source.hint >> 8;
+		if (handler_function == &CPU::OP_BITMOD)
+			return source.hint & H_TI ? 1 : 0;
+		if (handler_function == &CPU::OP_INC_EA || handler_function == &CPU::OP_DEC_EA)
+			return 1;
+		return 0;
+	}
+
+	template<size_t row>
+	size_t CPU::ExecuteSpecialized(const DecodedInstruction &decoded)
+	{
+		constexpr const OpcodeSource &source = opcode_sources[row];
+		constexpr bool changes_flags = ChangesFlags(source);
+		constexpr size_t data_bytes = DataBytes(source);
+
+		impl_opcode = decoded.opcode;
+		impl_long_imm = decoded.long_imm;
+		LoadOperand<source.operands[0].register_size>(0, decoded.operand_fields[0]);
+		LoadOperand<source.operands[1].register_size>(1, decoded.operand_fields[1]);
+		impl_hint = source.hint;
+		impl_cycles = source.cycles;
+
+		if constexpr (changes_flags)
+		{
 			impl_flags_changed = 0;
 			impl_flags_in = reg_psw;
 			/**
@@ -422,26 +555,146 @@ namespace casioemu
 			 * value it checks is non-zero, otherwise it leaves it alone.
 			 */
 			impl_flags_out = PSW_Z;
-			(this->*(handler->handler_function))();
-			if(code_viewer){
-				if((code_viewer->debug_flags & DEBUG_BREAKPOINT) && code_viewer->TryTrigBP(reg_csr, reg_pc)){
-					emulator.SetPaused(true);
-				}
-				else if((code_viewer->debug_flags)&DEBUG_STEP && code_viewer->TryTrigBP(reg_csr, reg_pc,false)){
-					emulator.SetPaused(true);
-				}
-			}
+		}
+
+		(this->*(source.handler_function))();
+		CheckBreakpoint();
+
+		if constexpr (changes_flags)
+		{
 			reg_psw &= ~impl_flags_changed;
 			reg_psw |= impl_flags_out & impl_flags_changed;
+		}
 
-			if (handler->hint & H_WB && impl_operands[0].register_size)
-				for (size_t bx = 0; bx != impl_operands[0].register_size; ++bx)
-					reg_r[impl_operands[0].register_index + bx] = (uint8_t)(impl_operands[0].value >> (bx * 8));
+		if constexpr (source.hint & H_WB && source.operands[0].register_size)
+			for (size_t bx = 0; bx != source.operands[0].register_size; ++bx)
+				reg_r[impl_operands[0].register_index + bx] = (uint8_t)(impl_operands[0].value >> (bx * 8));
 
-			if (!(handler->hint & H_DS))
-				break;
-			
-		}
+		if constexpr (data_bytes != 0)
+			if (reg_dsr)
+				impl_cycles += data_bytes;
+
+		return impl_cycles;
+	}
+
+	void CPU::CheckBreakpoint()
+	{
+		if (emulator.debugger && emulator.debugger->BreakAt(reg_csr, reg_pc))
+			emulator.SetPaused(true);
+	}
+
+/**
+ * `CASIOEMU_ROWS(row)` expands `row(N)` for every N in [0, 180). Every
+ * `opcode_sources` row gets its own label in the dispatch loops below, and
+ * each label jumps straight to the label of the next instruction (computed
+ * goto), so there's no shared dispatch branch for the host to mispredict.
+ */
+#define CASIOEMU_ROWS_10(row, tens) row(tens##0) row(tens##1) row(tens##2) row(tens##3) row(tens##4) \
+	row(tens##5) row(tens##6) row(tens##7) row(tens##8) row(tens##9)
+#define CASIOEMU_ROWS(row) CASIOEMU_ROWS_10(row, ) CASIOEMU_ROWS_10(row, 1) CASIOEMU_ROWS_10(row, 2) \
+	CASIOEMU_ROWS_10(row, 3) CASIOEMU_ROWS_10(row, 4) CASIOEMU_ROWS_10(row, 5) CASIOEMU_ROWS_10(row, 6) \
+	CASIOEMU_ROWS_10(row, 7) CASIOEMU_ROWS_10(row, 8) CASIOEMU_ROWS_10(row, 9) CASIOEMU_ROWS_10(row, 10) \
+	CASIOEMU_ROWS_10(row, 11) CASIOEMU_ROWS_10(row, 12) CASIOEMU_ROWS_10(row, 13) CASIOEMU_ROWS_10(row, 14) \
+	CASIOEMU_ROWS_10(row, 15) CASIOEMU_ROWS_10(row, 16) CASIOEMU_ROWS_10(row, 17)
+#define CASIOEMU_ROW_LABEL(index) &&row_##index,
+// * Rows past the end of the table are never jumped to, they only have to compile.
+#define CASIOEMU_ROW_INDEX(index) (index < opcode_source_count ? index : 0)
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // * Computed goto is a GNU extension.
+
+	size_t CPU::Next()
+	{
+		static_assert(opcode_source_count <= 180, "CASIOEMU_ROWS has to cover every row of opcode_sources");
+		static void *const row_labels[] = {CASIOEMU_ROWS(CASIOEMU_ROW_LABEL)};
+
+		/**
+		 * `reg_dsr` only affects the current instruction. The old DSR is stored in
+		 * `impl_last_dsr` and is recalled every time a DSR instruction is encountered
+		 * that activates DSR addressing without actually changing DSR.
+		 */
+		reg_dsr	= 0;
+
+		emulator.chipset.isMIBlocked = false;
+
+		const DecodedInstruction *decoded;
+		// * DSR prefixes are separate instructions with their own cost.
+		size_t cycles = 0;
+
+	fetch:
+		decoded = Decode();
+		if (!decoded)
+			goto fetch;
+		goto *row_labels[decoded->row];
+
+#define CASIOEMU_NEXT_ROW(index) \
+	row_##index: \
+		cycles += ExecuteSpecialized<CASIOEMU_ROW_INDEX(index)>(*decoded); \
+		if (opcode_sources[CASIOEMU_ROW_INDEX(index)].hint & H_DS) \
+			goto fetch; \
+		return cycles;
+
+		CASIOEMU_ROWS(CASIOEMU_NEXT_ROW)
+#undef CASIOEMU_NEXT_ROW
+	}
+
+	/**
+	 * See `RunBlock` in CPUTranslate.cpp.
+	 */
+	size_t CPU::ExecuteBlock(const TranslatedBlock &block)
+	{
+		static void *const row_labels[] = {CASIOEMU_ROWS(CASIOEMU_ROW_LABEL)};
+
+		Chipset &chipset = emulator.chipset;
+		size_t cycles = 0;
+
+		auto it = block.instructions.begin();
+		const DecodedInstruction *decoded = *it;
+		reg_dsr = 0;
+		chipset.isMIBlocked = false;
+		reg_pc.raw = (uint16_t)(reg_pc.raw + (decoded->handler->hint & H_TI ? 4 : 2));
+		goto *row_labels[decoded->row];
+
+#define CASIOEMU_BLOCK_ROW(index) \
+	row_##index: \
+		cycles += ExecuteSpecialized<CASIOEMU_ROW_INDEX(index)>(*decoded); \
+		if (++it == block.instructions.end() || LeavesBlock()) \
+			return cycles; \
+		decoded = *it; \
+		reg_dsr = 0; \
+		chipset.isMIBlocked = false; \
+		reg_pc.raw = (uint16_t)(reg_pc.raw + (decoded->handler->hint & H_TI ? 4 : 2)); \
+		goto *row_labels[decoded->row];
+
+		CASIOEMU_ROWS(CASIOEMU_BLOCK_ROW)
+#undef CASIOEMU_BLOCK_ROW
+	}
+
+#pragma GCC diagnostic pop
+
+	template<size_t row>
+	bool CPU::StepBlock(CPU *cpu, const DecodedInstruction *decoded)
+	{
+		cpu->reg_dsr = 0;
+		cpu->emulator.chipset.isMIBlocked = false;
+		cpu->block_cycles += cpu->ExecuteSpecialized<row>(*decoded);
+		return !cpu->LeavesBlock();
+	}
+
+#define CASIOEMU_BLOCK_STEP(index) &CPU::StepBlock<CASIOEMU_ROW_INDEX(index)>,
+	const CPU::BlockStep CPU::block_steps[] = {CASIOEMU_ROWS(CASIOEMU_BLOCK_STEP)};
+#undef CASIOEMU_BLOCK_STEP
+
+	/**
+	 * Whether something happened during the current block that the chipset
+	 * has to react to before the next instruction. See `RunBlock`.
+	 */
+	bool CPU::LeavesBlock()
+	{
+		Chipset &chipset = emulator.chipset;
+		return fetch_addition != 2 || chipset.run_mode != Chipset::RM_RUN || emulator.GetPaused() ||
+				chipset.pending_interrupt_count != block_pending_interrupt_count ||
+				(reg_psw.raw ^ block_psw) & (PSW_MIE | PSW_ELEVEL);
 	}
 
 	void CPU::SetMemoryModel(MemoryModel _memory_model)
@@ -463,6 +716,29 @@ namespace casioemu
 		stack.clear();
 	}
 
+	void CPU::SerializeState(StateArchive &archive)
+	{
+		archive.Section("CPU");
+		for (auto &reg : reg_r)
+			archive.Field(reg.raw);
+		for (auto &reg : reg_cr)
+			archive.Field(reg.raw);
+		archive.Field(reg_pc.raw);
+		archive.Field(reg_csr.raw);
+		for (size_t ix = 0; ix != 4; ++ix)
+		{
+			archive.Field(reg_elr[ix].raw);
+			archive.Field(reg_ecsr[ix].raw);
+			archive.Field(reg_epsw[ix].raw);
+		}
+		archive.Field(reg_sp.raw);
+		archive.Field(reg_ea.raw);
+		archive.Field(reg_dsr.raw);
+		archive.Field(impl_last_dsr);
+		archive.Field(fetch_addition);
+		archive.Field(stack);
+	}
+
 	void CPU::Raise(size_t exception_level, size_t index)
 	{
 		reg_epsw[exception_level].raw = reg_psw.raw;
@@ -505,8 +781,7 @@ namespace casioemu
 			{
 				uint16_t saved_lr, saved_lcsr = 0;
 				MMU &mmu = emulator.chipset.mmu;
-				saved_lr = ((uint16_t)mmu.ReadData(frame.lr_push_address + 1))
-					<< 8 | mmu.ReadData(frame.lr_push_address);
+				saved_lr = mmu.Read16(frame.lr_push_address);
 				if (memory_model == MM_LARGE)
 					saved_lcsr = mmu.ReadData(frame.lr_push_address + 2);
 				output << (((size_t)saved_lcsr) << 16 | saved_lr);
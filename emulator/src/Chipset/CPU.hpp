@@ -6,11 +6,14 @@
 #include <cstdint>
 #include <string>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace casioemu
 {
 	class Emulator;
+	class StateArchive;
 
 	class CPU
 	{
@@ -82,16 +85,15 @@ namespace casioemu
 			size_t register_index, register_size;
 		} impl_operands[2];
 		size_t impl_hint;
+		size_t impl_cycles;
 		uint16_t impl_csr_mask;
 
 		size_t fetch_addition;
 
-		void SetupOpcodeDispatch();
 		void SetupRegisterProxies();
 
 	public:
 		CPU(Emulator &emulator);
-		~CPU();
 		void SetupInternals();
 
 		/**
@@ -142,15 +144,34 @@ namespace casioemu
 		
 		bool real_hardware;
 
+		/**
+		 * Set by the `translate_blocks` command line argument. See `RunBlock`.
+		 */
+		bool translate_blocks;
+
+		~CPU();
 		void SetMemoryModel(MemoryModel memory_model);
 		void SetCPUModel(CPUModel cpu_model);
-		void Next();
+		size_t Next();
+		size_t RunBlock();
 		void Reset();
 		void Raise(size_t exception_level, size_t index);
 		void CorruptByDSR();
 		size_t GetExceptionLevel();
 		bool GetMasterInterruptEnable();
 		std::string GetBacktrace() const;
+		void SerializeState(StateArchive &archive);
+		/**
+		 * Sets the register called `name` (see `register_record_sources`).
+		 * Returns false if there's no such register.
+		 */
+		bool SetRegister(const std::string &name, uint16_t value);
+		/**
+		 * Points `raw` at the value of the register called `name` and sets
+		 * `mask` to its width, for reading it every instruction without a
+		 * lookup. Returns false if there's no such register.
+		 */
+		bool FindRegister(const std::string &name, const uint16_t *&raw, uint16_t &mask);
 
 	private:
 		struct StackFrame
@@ -195,9 +216,123 @@ namespace casioemu
 				size_t register_size;
 				uint16_t mask, shift;
 			} operands[2];
+			/**
+			 * Cost in SYSCLK cycles, counting one cycle per data byte transferred
+			 * and one more for a Disp6/Disp16/Dadr address. Adjusted at run time
+			 * for taken branches, PUSH/POP register lists and data accesses
+			 * outside segment 0 (one wait cycle per byte if DSR is non-zero).
+			 */
+			size_t cycles;
+		};
+		static const OpcodeSource opcode_sources[];
+		static const size_t opcode_source_count;
+		/**
+		 * Maps every opcode to its `opcode_sources` row. Only depends on the
+		 * table, so it's built once and shared by the CPUs of all emulators
+		 * in the process.
+		 */
+		const OpcodeSource *const *opcode_dispatch;
+		static std::unique_ptr<const OpcodeSource *[]> BuildOpcodeDispatch();
+		static const OpcodeSource *const *SharedOpcodeDispatch();
+
+		/**
+		 * An instruction as it comes out of `opcode_dispatch`, with the operand
+		 * fields already extracted and the long immediate (if any) already fetched.
+		 * Code only ever comes from ROM, so every ROM address is decoded once
+		 * and the result is kept for good: the ROM image is never written to.
+		 */
+		struct DecodedInstruction
+		{
+			/**
+			 * nullptr if this entry hasn't been decoded yet.
+			 */
+			const OpcodeSource *handler;
+			/**
+			 * Index of `handler` in `opcode_sources`, selects the specialized
+			 * handler that executes this instruction.
+			 */
+			uint16_t row;
+			uint16_t opcode, long_imm;
+			uint16_t operand_fields[2];
+		};
+		/**
+		 * One block of 0x8000 entries per 64K code segment covered by ROM,
+		 * allocated the first time code in that segment is executed.
+		 */
+		std::vector<std::unique_ptr<DecodedInstruction[]>> decode_cache;
+		DecodedInstruction decode_scratch;
+
+		const DecodedInstruction *Decode();
+		DecodedInstruction &CachedDecode(size_t offset);
+		void DecodeAt(DecodedInstruction &decoded, uint16_t opcode);
+
+		/**
+		 * `ExecuteSpecialized<N>` executes an instruction decoded as row N of
+		 * `opcode_sources`. Operand sizes, writeback and whether PSW flags have
+		 * to be merged are all known at compile time, so the generic loops and
+		 * branches that used to run for every instruction are gone.
+		 */
+		template<size_t row>
+		size_t ExecuteSpecialized(const DecodedInstruction &decoded);
+		template<size_t register_size>
+		void LoadOperand(size_t index, uint16_t field);
+		static constexpr bool ChangesFlags(const OpcodeSource &source);
+		static constexpr size_t DataBytes(const OpcodeSource &source);
+		void CheckBreakpoint();
+
+		/**
+		 * A straight run of cached instructions that ends at the first instruction
+		 * that may change CSR:PC other than by falling through (see `EndsBlock`).
+		 * DSR prefixes and invalid opcodes are never part of a block, those are
+		 * left to `Next`. Blocks are keyed by the code address of their first
+		 * instruction and, like the decode cache they point into, are kept for
+		 * good.
+		 */
+		struct TranslatedBlock
+		{
+			std::vector<DecodedInstruction *> instructions;
+			/**
+			 * x86-64 code for the block (see `CompileBlock`), or nullptr if it
+			 * couldn't be compiled and `ExecuteBlock` has to interpret it.
+			 */
+			void (*native)(CPU *cpu);
 		};
-		static OpcodeSource opcode_sources[];
-		OpcodeSource **opcode_dispatch;
+		std::unordered_map<size_t, TranslatedBlock> translated_blocks;
+		static const size_t max_block_length = 64;
+
+		TranslatedBlock &TranslateBlock(size_t offset);
+		static bool EndsBlock(const DecodedInstruction &decoded);
+		size_t ExecuteBlock(const TranslatedBlock &block);
+		bool LeavesBlock();
+
+		/**
+		 * Executes one instruction of a compiled block and adds its cycles to
+		 * `block_cycles`. Returns false if the block has to be left. Compiled
+		 * blocks call these directly, one per `opcode_sources` row.
+		 */
+		template<size_t row>
+		static bool StepBlock(CPU *cpu, const DecodedInstruction *decoded);
+		typedef bool (*BlockStep)(CPU *cpu, const DecodedInstruction *decoded);
+		static const BlockStep block_steps[];
+
+		/**
+		 * State of the block being run, see `LeavesBlock`.
+		 */
+		size_t block_cycles, block_pending_interrupt_count;
+		uint8_t block_psw;
+
+		/**
+		 * Executable memory the compiled blocks live in, allocated in chunks of
+		 * `code_chunk_size` bytes. `native_blocks` is cleared if allocating a
+		 * chunk fails, after which blocks are interpreted.
+		 */
+		std::vector<uint8_t *> code_chunks;
+		size_t code_chunk_used;
+		static const size_t code_chunk_size = 1 << 20;
+		bool native_blocks;
+
+		uint8_t *AllocateCode(size_t size);
+		void CompileBlock(TranslatedBlock &block, size_t offset);
 
 		typedef RegisterStub CPU::*RegisterStubPointer;
 		typedef RegisterStub (CPU::*RegisterStubArrayPointer)[];
@@ -208,7 +343,7 @@ namespace casioemu
 			RegisterStubPointer stub;
 			RegisterStubArrayPointer stub_array;
 		};
-		static RegisterRecord register_record_sources[];
+		static const RegisterRecord register_record_sources[];
 		std::map<std::string, RegisterStub *> register_proxies;
 
 		// * Arithmetic Instructions
@@ -4,7 +4,6 @@
 #include "Chipset.hpp"
 #include "MMU.hpp"
 
-#include "../Gui/ui.hpp"
 namespace casioemu
 {
 	// * Control Register Access Instructions
@@ -92,12 +91,18 @@ namespace casioemu
 		size_t register_size = impl_hint >> 8;
 
 		if (impl_hint & H_ST)
-			for (size_t ix = register_size - 1; ix != (size_t)-1; --ix)
-				emulator.chipset.mmu.WriteData((((size_t)reg_dsr) << 16) | (uint16_t)(reg_ea + ix), reg_cr[op0_index + ix]
-				);
+		{
+			uint64_t value = 0;
+			for (size_t ix = 0; ix != register_size; ++ix)
+				value |= ((uint64_t)reg_cr[op0_index + ix]) << (8 * ix);
+			emulator.chipset.mmu.WriteMulti((((size_t)reg_dsr) << 16) | reg_ea, value, register_size);
+		}
 		else
+		{
+			uint64_t value = emulator.chipset.mmu.ReadMulti((((size_t)reg_dsr) << 16) | reg_ea, register_size);
 			for (size_t ix = 0; ix != register_size; ++ix)
-				reg_cr[op0_index + ix] = emulator.chipset.mmu.ReadData((((size_t)reg_dsr) << 16) | (uint16_t)(reg_ea + ix));
+				reg_cr[op0_index + ix] = value >> (8 * ix);
+		}
 
 		if (impl_hint & H_IA)
 			BumpEA(register_size);
@@ -163,6 +168,8 @@ namespace casioemu
 		{
 			impl_operands[0].value |= (impl_operands[0].value & 0x80) ? 0x7F00 : 0;
 			reg_pc += impl_operands[0].value << 1;
+			// * Refilling the pipeline.
+			impl_cycles += 2;
 		}
 	}
 
@@ -48,14 +48,17 @@ namespace casioemu
 		size_t reg_base = impl_operands[0].value;
 		if (impl_hint & H_ST)
 		{
-			for (size_t ix = length - 1; ix != (size_t)-1; --ix)
-				emulator.chipset.mmu.WriteData((((size_t)reg_dsr) << 16) | (uint16_t)(offset + ix), reg_r[reg_base + ix]);
+			uint64_t value = 0;
+			for (size_t ix = 0; ix != length; ++ix)
+				value |= ((uint64_t)reg_r[reg_base + ix]) << (8 * ix);
+			emulator.chipset.mmu.WriteMulti((((size_t)reg_dsr) << 16) | offset, value, length);
 		}
 		else
 		{
+			uint64_t value = emulator.chipset.mmu.ReadMulti((((size_t)reg_dsr) << 16) | offset, length);
 			for (size_t ix = 0; ix != length; ++ix)
 			{
-				impl_operands[0].value = emulator.chipset.mmu.ReadData((((size_t)reg_dsr) << 16) | (uint16_t)(offset + ix));
+				impl_operands[0].value = (value >> (8 * ix)) & 0xFF;
 				ZSCheck(); // * defined in CPUArithmetic.cpp
 				reg_r[reg_base + ix] = impl_operands[0].value;
 			}
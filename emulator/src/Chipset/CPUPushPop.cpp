@@ -1,11 +1,10 @@
 #include "CPU.hpp"
 
 #include "../Emulator.hpp"
+#include "../Debugger.hpp"
 #include "Chipset.hpp"
 #include "MMU.hpp"
 
-#include "../Gui/ui.hpp"
-
 namespace casioemu
 {
 	// * PUSH/POP Instructions
@@ -15,8 +14,7 @@ namespace casioemu
 		if (push_size == 1)
 			push_size = 2;
 		reg_sp -= push_size;
-		for (size_t ix = impl_operands[1].register_size - 1; ix != (size_t)-1; --ix)
-			emulator.chipset.mmu.WriteData(reg_sp + ix, impl_operands[1].value >> (8 * ix));
+		emulator.chipset.mmu.WriteMulti(reg_sp, impl_operands[1].value, impl_operands[1].register_size);
 	}
 
 	void CPU::OP_PUSHL()
@@ -54,9 +52,7 @@ namespace casioemu
 		size_t pop_size = impl_operands[0].register_size;
 		if (pop_size == 1)
 			pop_size = 2;
-		impl_operands[0].value = 0;
-		for (size_t ix = 0; ix != impl_operands[0].register_size; ++ix)
-			impl_operands[0].value |= ((uint64_t)emulator.chipset.mmu.ReadData(reg_sp + ix)) << (8 * ix);
+		impl_operands[0].value = emulator.chipset.mmu.ReadMulti(reg_sp, impl_operands[0].register_size);
 		reg_sp += pop_size;
 	}
 
@@ -88,13 +84,10 @@ namespace casioemu
 			reg_pc = Pop16();
 			if (memory_model == MM_LARGE)
 				reg_csr = Pop16() & 0x000F;
-			if(code_viewer){
-				if(code_viewer->debug_flags & DEBUG_RET_TRACE){
-					if(code_viewer->TryTrigBP(reg_csr, reg_pc,false)){
-						emulator.SetPaused(true);
-					}
-				}
-			}
+			// * Refilling the pipeline.
+			impl_cycles += 2;
+			if (emulator.debugger && emulator.debugger->BreakOnReturn(reg_csr, reg_pc))
+				emulator.SetPaused(true);
 			if (!stack.empty() && stack.back().lr_pushed &&
 					stack.back().lr_push_address == oldsp)
 				stack.pop_back();
@@ -105,14 +98,15 @@ namespace casioemu
 	void CPU::Push16(uint16_t data)
 	{
 		reg_sp -= 2;
-		emulator.chipset.mmu.WriteData(reg_sp + 1, data >> 8);
-		emulator.chipset.mmu.WriteData(reg_sp, data & 0xFF);
+		emulator.chipset.mmu.Write16(reg_sp, data);
+		impl_cycles += 2;
 	}
 
 	uint16_t CPU::Pop16()
 	{
-		uint16_t result = emulator.chipset.mmu.ReadData(reg_sp) | (((uint16_t)emulator.chipset.mmu.ReadData(reg_sp + 1)) << 8);
+		uint16_t result = emulator.chipset.mmu.Read16(reg_sp);
 		reg_sp += 2;
+		impl_cycles += 2;
 		return result;
 	}
 }
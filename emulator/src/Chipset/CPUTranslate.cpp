@@ -0,0 +1,258 @@
+#include "CPU.hpp"
+
+#include "../Emulator.hpp"
+#include "Chipset.hpp"
+
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CASIOEMU_NATIVE_BLOCKS
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+namespace casioemu
+{
+#ifdef CASIOEMU_NATIVE_BLOCKS
+	namespace
+	{
+		struct CodeWriter
+		{
+			uint8_t *at;
+
+			void Bytes(std::initializer_list<uint8_t> bytes)
+			{
+				for (uint8_t byte : bytes)
+					*at++ = byte;
+			}
+
+			template<typename value_type>
+			void Value(value_type value)
+			{
+				for (size_t ix = 0; ix != sizeof(value_type); ++ix)
+					*at++ = (uint8_t)((uint64_t)value >> (ix * 8));
+			}
+		};
+
+		// * Upper bounds of the code `CompileBlock` emits.
+		// * push rbx; mov rbx, <first argument>; shadow space for callees on Windows.
+		const size_t prologue_size = 8;
+		// * mov [rbx + disp32], imm16; mov <arguments>; mov rax, imm64; call rax; test al, al; jz rel32.
+		const size_t step_size = 42;
+		// * Shadow space, pop rbx, ret.
+		const size_t epilogue_size = 6;
+	}
+#endif
+
+	CPU::~CPU()
+	{
+#ifdef CASIOEMU_NATIVE_BLOCKS
+		for (uint8_t *chunk : code_chunks)
+		{
+#ifdef _WIN32
+			VirtualFree(chunk, 0, MEM_RELEASE);
+#else
+			munmap(chunk, code_chunk_size);
+#endif
+		}
+#endif
+	}
+
+	bool CPU::EndsBlock(const DecodedInstruction &decoded)
+	{
+		auto handler_function = decoded.handler->handler_function;
+		if (handler_function == &CPU::OP_B || handler_function == &CPU::OP_BL ||
+				handler_function == &CPU::OP_BC || handler_function == &CPU::OP_RT ||
+				handler_function == &CPU::OP_RTI || handler_function == &CPU::OP_SWI ||
+				handler_function == &CPU::OP_BRK)
+			return true;
+
+		// * `POP PC` is a return as well.
+		return handler_function == &CPU::OP_POPL && decoded.operand_fields[0] & 2;
+	}
+
+	CPU::TranslatedBlock &CPU::TranslateBlock(size_t offset)
+	{
+		TranslatedBlock &block = translated_blocks[offset];
+
+		size_t segment_base = offset & ~0xFFFF;
+		uint16_t pc = offset & 0xFFFF;
+		while (block.instructions.size() != max_block_length)
+		{
+			if ((segment_base | pc) >= emulator.chipset.rom_data->size())
+				break;
+
+			DecodedInstruction &decoded = CachedDecode(segment_base | pc);
+			if (!decoded.handler || decoded.handler->hint & H_DS)
+				break;
+
+			block.instructions.push_back(&decoded);
+			if (EndsBlock(decoded))
+				break;
+
+			pc += decoded.handler->hint & H_TI ? 4 : 2;
+		}
+
+		if (native_blocks && !block.instructions.empty())
+			CompileBlock(block, offset);
+		return block;
+	}
+
+	uint8_t *CPU::AllocateCode(size_t size)
+	{
+#ifdef CASIOEMU_NATIVE_BLOCKS
+		if (code_chunks.empty() || code_chunk_used + size > code_chunk_size)
+		{
+#ifdef _WIN32
+			void *chunk = VirtualAlloc(nullptr, code_chunk_size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+			void *chunk = mmap(nullptr, code_chunk_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (chunk == MAP_FAILED)
+				chunk = nullptr;
+#endif
+			if (!chunk)
+			{
+				logger::Info("failed to allocate executable memory, blocks will be interpreted\n");
+				native_blocks = false;
+				return nullptr;
+			}
+
+			code_chunks.push_back((uint8_t *)chunk);
+			code_chunk_used = 0;
+		}
+
+		uint8_t *code = code_chunks.back() + code_chunk_used;
+		code_chunk_used += size;
+		return code;
+#else
+		(void)size;
+		native_blocks = false;
+		return nullptr;
+#endif
+	}
+
+	/**
+	 * Compiles `block` (starting at `offset`) to x86-64 code that calls the
+	 * `StepBlock` of every instruction in turn and returns as soon as one of
+	 * them asks to leave the block. CSR:PC of every instruction is known
+	 * here, so PC is set by the compiled code itself. On other hosts, or if
+	 * there's no executable memory, `block.native` stays nullptr.
+	 */
+	void CPU::CompileBlock(TranslatedBlock &block, size_t offset)
+	{
+#ifdef CASIOEMU_NATIVE_BLOCKS
+		uint8_t *code = AllocateCode(prologue_size + step_size * block.instructions.size() + epilogue_size);
+		if (!code)
+			return;
+
+		CodeWriter out{code};
+		out.Bytes({0x53}); // * push rbx
+#ifdef _WIN32
+		out.Bytes({0x48, 0x89, 0xCB}); // * mov rbx, rcx
+		out.Bytes({0x48, 0x83, 0xEC, 0x20}); // * sub rsp, 32
+#else
+		out.Bytes({0x48, 0x89, 0xFB}); // * mov rbx, rdi
+#endif
+
+		int32_t pc_displacement = (int32_t)((uint8_t *)&reg_pc.raw - (uint8_t *)this);
+		uint16_t pc = offset & 0xFFFF;
+		std::vector<uint8_t *> exits;
+		for (const DecodedInstruction *decoded : block.instructions)
+		{
+			pc += decoded->handler->hint & H_TI ? 4 : 2;
+			out.Bytes({0x66, 0xC7, 0x83}); // * mov word [rbx + disp32], imm16
+			out.Value(pc_displacement);
+			out.Value(pc);
+#ifdef _WIN32
+			out.Bytes({0x48, 0x89, 0xD9}); // * mov rcx, rbx
+			out.Bytes({0x48, 0xBA}); // * mov rdx, imm64
+#else
+			out.Bytes({0x48, 0x89, 0xDF}); // * mov rdi, rbx
+			out.Bytes({0x48, 0xBE}); // * mov rsi, imm64
+#endif
+			out.Value((uintptr_t)decoded);
+			out.Bytes({0x48, 0xB8}); // * mov rax, imm64
+			out.Value((uintptr_t)block_steps[decoded->row]);
+			out.Bytes({0xFF, 0xD0}); // * call rax
+			out.Bytes({0x84, 0xC0}); // * test al, al
+			out.Bytes({0x0F, 0x84}); // * jz rel32
+			exits.push_back(out.at);
+			out.Value((int32_t)0);
+		}
+
+		for (uint8_t *exit : exits)
+		{
+			int32_t rel = (int32_t)(out.at - (exit + 4));
+			CodeWriter{exit}.Value(rel);
+		}
+#ifdef _WIN32
+		out.Bytes({0x48, 0x83, 0xC4, 0x20}); // * add rsp, 32
+#endif
+		out.Bytes({0x5B}); // * pop rbx
+		out.Bytes({0xC3}); // * ret
+
+		block.native = reinterpret_cast<void (*)(CPU *)>(code);
+#else
+		(void)block;
+		(void)offset;
+		native_blocks = false;
+#endif
+	}
+
+	/**
+	 * Executes the translated block starting at CSR:PC and returns the number
+	 * of SYSCLK cycles it took, which the chipset has to account for before
+	 * the CPU runs again. Falls back to a single `Next` (DSR prefixes, code
+	 * outside ROM, a pending `CorruptByDSR`) if there is no block to run.
+	 * Blocks run as native code on x86-64 hosts (see `CompileBlock`) and are
+	 * interpreted by `ExecuteBlock` elsewhere.
+	 *
+	 * Peripherals don't tick while a block runs, so the block is left early as
+	 * soon as something happens that the chipset has to react to before the
+	 * next instruction: halting, new interrupts, MIE or ELEVEL changing, or the
+	 * emulator being paused by a breakpoint.
+	 *
+	 * Lua instruction hooks run between instructions, so nothing is
+	 * translated while any of them is registered.
+	 */
+	size_t CPU::RunBlock()
+	{
+		if (!translate_blocks || fetch_addition != 2 || emulator.instruction_hooks)
+		{
+			return Next();
+		}
+
+		if (reg_csr.raw & ~impl_csr_mask)
+			reg_csr.raw &= impl_csr_mask;
+		if (reg_pc.raw & 1)
+			reg_pc.raw &= ~1;
+
+		size_t offset = (reg_csr.raw << 16) | reg_pc.raw;
+		if (offset >= emulator.chipset.rom_data->size())
+		{
+			return Next();
+		}
+
+		auto it = translated_blocks.find(offset);
+		TranslatedBlock &block = it == translated_blocks.end() ? TranslateBlock(offset) : it->second;
+		if (block.instructions.empty())
+		{
+			return Next();
+		}
+
+		block_pending_interrupt_count = emulator.chipset.pending_interrupt_count;
+		block_psw = reg_psw.raw;
+		if (block.native)
+		{
+			block_cycles = 0;
+			block.native(this);
+			return block_cycles;
+		}
+
+		return ExecuteBlock(block);
+	}
+}
@@ -6,6 +6,7 @@
 #include "CPU.hpp"
 #include "MMU.hpp"
 #include "InterruptSource.hpp"
+#include "../Data/StateArchive.hpp"
 
 #include "../Peripheral/ROMWindow.hpp"
 #include "../Peripheral/BatteryBackedRAM.hpp"
@@ -22,17 +23,18 @@
 #include "../Peripheral/ExternalInterrupts.hpp"
 #include "../Peripheral/IOPorts.hpp"
 
-#include "../Gui/ui.hpp"
-
 #include <fstream>
 #include <algorithm>
 #include <cstring>
 #include <cmath>
+#include <map>
+#include <mutex>
 
 namespace casioemu
 {
 	Chipset::Chipset(Emulator &_emulator) : emulator(_emulator), cpu(*new CPU(emulator)), mmu(*new MMU(emulator))
 	{
+		instruction_count = 0;
 	}
 
 	void Chipset::Setup()
@@ -298,15 +300,25 @@ namespace casioemu
 			}
 		}, emulator);
 
+		for (auto &list : tick_lists)
+		{
+			list.idle_ticks = Peripheral::idle_forever;
+			list.skipped_ticks = 0;
+		}
+		schedule_dirty = true;
+
 		ioport = new IOPorts(emulator);
 		EXIhandle = new ExternalInterrupts(emulator);
+		screen = CreateScreen(emulator);
+		keyboard = new Keyboard(emulator);
+		battery_backed_ram = new BatteryBackedRAM(emulator);
 
 		peripherals.push_front(new ROMWindow(emulator));
-		peripherals.push_front(new BatteryBackedRAM(emulator));
-		peripherals.push_front(CreateScreen(emulator));
+		peripherals.push_front(battery_backed_ram);
+		peripherals.push_front(screen);
 		peripherals.push_front(ioport);
 		peripherals.push_front(EXIhandle);
-		peripherals.push_front(new Keyboard(emulator));
+		peripherals.push_front(keyboard);
 		peripherals.push_front(new StandbyControl(emulator));
 		peripherals.push_front(new Miscellaneous(emulator));
 		peripherals.push_front(new Timer(emulator));
@@ -329,12 +341,31 @@ namespace casioemu
 		}
 	}
 
-	void Chipset::SetupInternals()
+	/**
+	 * Returns the contents of the ROM file at `path`, reading it only if no
+	 * emulator in the process has it loaded already.
+	 */
+	static std::shared_ptr<const std::vector<unsigned char>> LoadROMImage(const std::string &path)
 	{
-		std::ifstream rom_handle(emulator.GetModelFilePath(emulator.GetModelInfo("rom_path")), std::ifstream::binary);
+		static std::mutex rom_cache_mx;
+		static std::map<std::string, std::weak_ptr<const std::vector<unsigned char>>> rom_cache;
+
+		std::lock_guard<std::mutex> rom_cache_lock(rom_cache_mx);
+		std::shared_ptr<const std::vector<unsigned char>> rom_image = rom_cache[path].lock();
+		if (rom_image)
+			return rom_image;
+
+		std::ifstream rom_handle(path, std::ifstream::binary);
 		if (rom_handle.fail())
 			PANIC("std::ifstream failed: %s\n", std::strerror(errno));
-		rom_data = std::vector<unsigned char>((std::istreambuf_iterator<char>(rom_handle)), std::istreambuf_iterator<char>());
+		rom_image = std::make_shared<const std::vector<unsigned char>>((std::istreambuf_iterator<char>(rom_handle)), std::istreambuf_iterator<char>());
+		rom_cache[path] = rom_image;
+		return rom_image;
+	}
+
+	void Chipset::SetupInternals()
+	{
+		rom_data = LoadROMImage(emulator.GetModelFilePath(emulator.GetModelInfo("rom_path")));
 
 		for (auto &peripheral : peripherals)
 			peripheral->Initialise();
@@ -359,7 +390,18 @@ namespace casioemu
 		for (auto &peripheral : peripherals)
 			peripheral->Reset();
 
+		// * Ticks skipped before the reset don't count anymore. This may run
+		//   from within `TickPeripherals` (WDT), so the lists stay as they are.
+		for (auto &list : tick_lists)
+		{
+			list.skipped_ticks = 0;
+			for (auto &entry : list.entries)
+				entry.skipped_ticks = 0;
+		}
+		schedule_dirty = true;
+
 		cpu.Reset();
+		cpu_delay = 0;
 
 		interrupts_active[INT_RESET] = true;
 		pending_interrupt_count = 1;
@@ -367,6 +409,64 @@ namespace casioemu
 		run_mode = RM_RUN;
 	}
 
+	void Chipset::SerializeState(StateArchive &archive)
+	{
+		// * Peripherals have to be up to date before they are saved, and have
+		//   their idle ticks recomputed after they are loaded.
+		SyncPeripherals();
+
+		archive.Section("Chipset");
+		archive.Field(run_mode);
+		archive.Field(cpu_delay);
+		archive.Field(pending_interrupt_count);
+		archive.Field(interrupts_active);
+		archive.Field(data_int_mask);
+		archive.Field(data_int_pending);
+		for (size_t ix = 0; ix != EffectiveMICount; ++ix)
+			MaskableInterrupts[ix].SerializeState(archive);
+		archive.Field(isMIBlocked);
+		archive.Field(WDT_enabled);
+		archive.Field(data_BLKCON);
+		archive.Field(data_EXICON);
+		archive.Field(SegmentAccess);
+		archive.Field(EmuTimerSkipped);
+
+		archive.Field(data_FCON);
+		archive.Field(data_LTBR);
+		archive.Field(data_HTBR);
+		archive.Field(data_LTBADJ);
+		archive.Field(LSCLKFreq);
+		archive.Field(LSCLKFreqAddition);
+		archive.Field(LSCLKTickCounter);
+		archive.Field(HSCLKTickCounter);
+		archive.Field(HSCLKTimeCounter);
+		archive.Field(SYSCLKTickCounter);
+		archive.Field(LSCLKTimeCounter);
+		archive.Field(LSCLKThresh);
+		archive.Field(LSCLK_output);
+		archive.Field(HSCLK_output);
+		archive.Field(ClockDiv);
+		archive.Field(LSCLKMode);
+		archive.Field(LSCLKTick);
+		archive.Field(HSCLKTick);
+		archive.Field(SYSCLKTick);
+		archive.Field(LTBCReset);
+		archive.Field(HTBCReset);
+
+		archive.Field(Port0Inputlevel);
+		archive.Field(Port1Inputlevel);
+		archive.Field(Port0Outputlevel);
+		archive.Field(Port1Outputlevel);
+		archive.Field(UserInput_level_Port0);
+		archive.Field(UserInput_level_Port1);
+		archive.Field(UserInput_state_Port0);
+		archive.Field(UserInput_state_Port1);
+
+		cpu.SerializeState(archive);
+		for (auto peripheral : peripherals)
+			peripheral->SerializeState(archive);
+	}
+
 	void Chipset::Break()
 	{
 		if (cpu.GetExceptionLevel() > 1)
@@ -521,6 +621,7 @@ namespace casioemu
 			break;
 		}
 
+		bool accepted = false;
 		if (index >= INT_MASKABLE && index < INT_SOFTWARE)
 		{
 			if (cpu.GetMasterInterruptEnable() && acceptable && (!isMIBlocked)) {
@@ -529,6 +630,7 @@ namespace casioemu
 
 				interrupts_active[index] = false;
 				pending_interrupt_count--;
+				accepted = true;
 			}
 			
 		}
@@ -539,13 +641,19 @@ namespace casioemu
 				SetInterruptPendingSFR(INT_NONMASKABLE, false);
 				interrupts_active[index] = false;
 				pending_interrupt_count--;
+				accepted = true;
 			}
 		} else {
 			cpu.Raise(exception_level, index);
 			interrupts_active[index] = false;
 			pending_interrupt_count--;
+			accepted = true;
 		}
 
+		// * `SWI` and `BRK` already paid for the transfer as instructions.
+		if (accepted && index != INT_BREAK && index < INT_SOFTWARE)
+			cpu_delay += interrupt_entry_cycles;
+
 		run_mode = RM_RUN;
 	}
 
@@ -569,13 +677,24 @@ namespace casioemu
 		});
 	}
 
-	void Chipset::InputToPort(int port, int pin, bool value) {
+	void Chipset::InputToPort(int port, int pin, bool value)
+	{
+		emulator.Input(Emulator::InputEvent(Emulator::InputEvent::IE_PORT_INPUT, port, pin << 1 | value));
+	}
+
+	void Chipset::RemovePortInput(int port, int pin)
+	{
+		emulator.Input(Emulator::InputEvent(Emulator::InputEvent::IE_REMOVE_PORT_INPUT, port, pin));
+	}
+
+	void Chipset::ApplyPortInput(int port, int pin, bool value) {
 		if(port == 0) {
 			if(pin < 1 || pin > 3)
 				PANIC("Trying to input to invalid pin %d of Port0!", pin);
 			UserInput_level_Port0[pin - 1] = value;
 			UserInput_state_Port0[pin - 1] = true;
 			ioport->AcceptInput(0, pin - 1);
+			InvalidateTickSchedule();
 		} else if(port == 1) {
 			if(pin < 0 || pin > 6)
 				PANIC("Trying to input to invalid pin %d of Port1!", pin);
@@ -587,13 +706,14 @@ namespace casioemu
 		}
 	}
 
-	void Chipset::RemovePortInput(int port, int pin) {
+	void Chipset::ApplyRemovePortInput(int port, int pin) {
 		if(port == 0) {
 			if(pin < 1 || pin > 3)
 				PANIC("Trying to remove input from invalid pin %d of Port0!", pin);
 			UserInput_level_Port0[pin - 1] = false;
 			UserInput_state_Port0[pin - 1] = false;
 			ioport->AcceptInput(0, pin - 1);
+			InvalidateTickSchedule();
 		} else if(port == 1) {
 			if(pin < 0 || pin > 6)
 				PANIC("Trying to remove input from invalid pin %d of Port1!", pin);
@@ -605,42 +725,248 @@ namespace casioemu
 		}
 	}
 
+	void Chipset::PublishFrame()
+	{
+		// * The screen publishes its frames itself, see `Emulator::RunCycles`.
+		for (auto peripheral : peripherals)
+			if (peripheral != screen)
+				peripheral->Publish();
+	}
+
 	void Chipset::Frame()
 	{
 		for (auto peripheral : peripherals)
-			peripheral->Frame();
+			if (peripheral != screen)
+				peripheral->Frame();
 	}
 
-	void Chipset::Tick()
+	void Chipset::SyncPeripherals()
+	{
+		FlushSkippedTicks();
+		schedule_dirty = true;
+	}
+
+	void Chipset::InvalidateTickSchedule()
+	{
+		schedule_dirty = true;
+	}
+
+	void Chipset::FlushSkippedTicks()
+	{
+		for (auto &list : tick_lists)
+		{
+			for (auto &entry : list.entries)
+			{
+				entry.idle_ticks -= list.skipped_ticks;
+				entry.skipped_ticks += list.skipped_ticks;
+				if (entry.skipped_ticks)
+				{
+					entry.peripheral->SkipTicks(entry.skipped_ticks);
+					entry.skipped_ticks = 0;
+				}
+			}
+			list.skipped_ticks = 0;
+		}
+	}
+
+	void Chipset::SchedulePeripherals()
+	{
+		FlushSkippedTicks();
+
+		for (auto &list : tick_lists)
+			list.entries.clear();
+
+		// * Peripherals that are idle for good don't need to be in any list.
+		for (auto peripheral : peripherals)
+		{
+			int clock_type = peripheral->GetClockType();
+			if (clock_type < CLOCK_UNDEFINED || clock_type >= CLOCK_STOPPED)
+				continue;
+			size_t idle_ticks = peripheral->GetIdleTicks();
+			if (idle_ticks != Peripheral::idle_forever)
+				tick_lists[clock_type].entries.push_back({peripheral, idle_ticks, 0});
+		}
+
+		for (auto &list : tick_lists)
+		{
+			list.idle_ticks = Peripheral::idle_forever;
+			for (auto &entry : list.entries)
+				list.idle_ticks = std::min(list.idle_ticks, entry.idle_ticks);
+		}
+
+		scheduled_LSCLK_output = LSCLK_output;
+		scheduled_HSCLK_output = HSCLK_output;
+		schedule_dirty = false;
+	}
+
+	void Chipset::TickPeripherals(TickList &list)
 	{
-		// * TODO: decrement delay counter, return if it's not 0
+		if (list.idle_ticks)
+		{
+			list.idle_ticks--;
+			list.skipped_ticks++;
+			return;
+		}
+
+		for (auto &entry : list.entries)
+		{
+			entry.idle_ticks -= list.skipped_ticks;
+			entry.skipped_ticks += list.skipped_ticks;
+		}
+		list.skipped_ticks = 0;
 
+		list.idle_ticks = Peripheral::idle_forever;
+		for (auto &entry : list.entries)
+		{
+			if (entry.idle_ticks)
+			{
+				entry.idle_ticks--;
+				entry.skipped_ticks++;
+			}
+			else
+			{
+				if (entry.skipped_ticks)
+				{
+					entry.peripheral->SkipTicks(entry.skipped_ticks);
+					entry.skipped_ticks = 0;
+				}
+				entry.peripheral->Tick();
+				entry.idle_ticks = entry.peripheral->GetIdleTicks();
+			}
+			list.idle_ticks = std::min(list.idle_ticks, entry.idle_ticks);
+		}
+	}
+
+	/**
+	 * Advances a clock divider counter that ticks when `++counter >= period`
+	 * by `cycles` and returns the number of ticks that happened.
+	 */
+	static size_t CountTicks(long long &counter, long long period, size_t cycles)
+	{
+		size_t first = counter < period ? period - counter : 1;
+		if (cycles < first)
+		{
+			counter += cycles;
+			return 0;
+		}
+		cycles -= first;
+		counter = cycles % period;
+		return 1 + cycles / period;
+	}
+
+	/**
+	 * Returns how many cycles such a counter can advance with at most
+	 * `allowed_ticks` ticks happening, capped at `max_cycles`.
+	 */
+	static size_t CyclesBeforeTick(long long counter, long long period, size_t allowed_ticks, size_t max_cycles)
+	{
+		if (allowed_ticks >= max_cycles)
+			return max_cycles;
+		size_t first = counter < period ? period - counter : 1;
+		return std::min<size_t>(first + allowed_ticks * period - 1, max_cycles);
+	}
+
+	void Chipset::SkipTicks(TickList &list, size_t ticks)
+	{
+		list.idle_ticks -= ticks;
+		list.skipped_ticks += ticks;
+	}
+
+	size_t Chipset::SkipIdleCycles(size_t max_cycles)
+	{
+		if (run_mode == RM_RUN || pending_interrupt_count || LTBCReset || HTBCReset || LSCLKTick || HSCLKTick || SYSCLKTick)
+			return 0;
+
+		if (LSCLK_output != scheduled_LSCLK_output || HSCLK_output != scheduled_HSCLK_output)
+			schedule_dirty = true;
+		if (schedule_dirty)
+			SchedulePeripherals();
+
+		size_t cycles = std::min(max_cycles, tick_lists[CLOCK_UNDEFINED].idle_ticks);
+
+		if (!real_hardware)
+		{
+			// * SYSCLK, HSCLK and LSCLK are all the same here.
+			size_t idle_ticks = std::min({tick_lists[CLOCK_LSCLK].idle_ticks, tick_lists[CLOCK_HSCLK].idle_ticks, tick_lists[CLOCK_SYSCLK].idle_ticks});
+			cycles = CyclesBeforeTick(SYSCLKTickCounter, 2, idle_ticks, cycles);
+			if (!cycles)
+				return 0;
+
+			size_t ticks = CountTicks(SYSCLKTickCounter, 2, cycles);
+			SkipTicks(tick_lists[CLOCK_UNDEFINED], cycles);
+			SkipTicks(tick_lists[CLOCK_LSCLK], ticks);
+			SkipTicks(tick_lists[CLOCK_HSCLK], ticks);
+			SkipTicks(tick_lists[CLOCK_SYSCLK], ticks);
+			return cycles;
+		}
+
+		bool HSCLK_running = run_mode != RM_STOP;
+		if (HSCLK_running)
+		{
+			// * The HTBR output and the tick clearing it are left to `Tick`.
+			if (HSCLK_output)
+				return 0;
+			size_t HSCLK_ticks = std::min<size_t>(tick_lists[CLOCK_HSCLK].idle_ticks, HTBROutputCount - 1 - HSCLKTimeCounter);
+			HSCLK_ticks = CyclesBeforeTick(SYSCLKTickCounter, 2, tick_lists[CLOCK_SYSCLK].idle_ticks, HSCLK_ticks);
+			cycles = CyclesBeforeTick(HSCLKTickCounter, ClockDiv, HSCLK_ticks, cycles);
+		}
+
+		long long LSCLK_period = std::max<long long>(emulator.GetCyclesPerSecond() / LSCLKFreq + LSCLKFreqAddition, 1);
+		if (LSCLKMode)
+		{
+			// * LTBADJ makes the LSCLK period vary, so `Tick` has to see every LSCLK tick then.
+			size_t LSCLK_ticks = LSCLKThresh || LSCLKFreqAddition ? 0 : tick_lists[CLOCK_LSCLK].idle_ticks;
+			cycles = CyclesBeforeTick(LSCLKTickCounter, LSCLK_period, LSCLK_ticks, cycles);
+		}
+
+		if (!cycles)
+			return 0;
+
+		SkipTicks(tick_lists[CLOCK_UNDEFINED], cycles);
+		if (HSCLK_running)
+		{
+			size_t HSCLK_ticks = CountTicks(HSCLKTickCounter, ClockDiv, cycles);
+			HSCLKTimeCounter += HSCLK_ticks;
+			SkipTicks(tick_lists[CLOCK_HSCLK], HSCLK_ticks);
+			SkipTicks(tick_lists[CLOCK_SYSCLK], CountTicks(SYSCLKTickCounter, 2, HSCLK_ticks));
+		}
+		if (LSCLKMode)
+			SkipTicks(tick_lists[CLOCK_LSCLK], CountTicks(LSCLKTickCounter, LSCLK_period, cycles));
+		return cycles;
+	}
+
+	void Chipset::Tick()
+	{
 		GenerateTickForClock();
 
-		for (auto peripheral : peripherals) {
-			switch (peripheral->GetClockType())
+		// * The RTC and the WDT wait for outputs of the time base counters.
+		if (LSCLK_output != scheduled_LSCLK_output || HSCLK_output != scheduled_HSCLK_output)
+			schedule_dirty = true;
+		if (schedule_dirty)
+			SchedulePeripherals();
+
+		TickPeripherals(tick_lists[CLOCK_UNDEFINED]);
+		if (LTBCReset)
+		{
+			// * Rare enough to tick everything the old way, which keeps the order
+			//   between resetting the TBC and the RTC seeing its output.
+			FlushSkippedTicks();
+			for (auto peripheral : peripherals)
 			{
-			case CLOCK_UNDEFINED:
-				peripheral->Tick();
-				break;
-			case CLOCK_LSCLK:
-				if(LTBCReset)
-					peripheral->ResetLSCLK();
-				if(LSCLKTick)
-					peripheral->Tick();
-				break;
-			case CLOCK_HSCLK:
-				if(HSCLKTick)
-					peripheral->Tick();
-				break;
-			case CLOCK_SYSCLK:
-				if(SYSCLKTick)
+				if (peripheral->GetClockType() != CLOCK_LSCLK)
+					continue;
+				peripheral->ResetLSCLK();
+				if (LSCLKTick)
 					peripheral->Tick();
-				break;
-			default:
-				break;
 			}
+			schedule_dirty = true;
 		}
+		else if (LSCLKTick)
+			TickPeripherals(tick_lists[CLOCK_LSCLK]);
+		if (HSCLKTick)
+			TickPeripherals(tick_lists[CLOCK_HSCLK]);
+		if (SYSCLKTick)
+			TickPeripherals(tick_lists[CLOCK_SYSCLK]);
 
 		if (pending_interrupt_count) {
 			AcceptInterrupt();
@@ -649,7 +975,13 @@ namespace casioemu
 		}
 
 		if (run_mode == RM_RUN && SYSCLKTick) {
-			cpu.Next();
+			if (cpu_delay)
+				cpu_delay--;
+			else
+			{
+				cpu_delay = cpu.RunBlock() - 1;
+				++instruction_count;
+			}
 		}
 
 		LSCLKTick = false;
@@ -662,6 +994,7 @@ namespace casioemu
 	{
 		for (auto peripheral : peripherals)
 			peripheral->UIEvent(event);
+		InvalidateTickSchedule();
 	}
 }
 
@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 #include <forward_list>
+#include <memory>
 #include <SDL.h>
 
 namespace casioemu
@@ -18,6 +19,10 @@ namespace casioemu
 	class CPU;
 	class MMU;
 	class Peripheral;
+	class ScreenBase;
+	class Keyboard;
+	class BatteryBackedRAM;
+	class StateArchive;
 
 	class Chipset
 	{
@@ -41,8 +46,45 @@ namespace casioemu
 		};
 		RunMode run_mode;
 
+		/**
+		 * Number of SYSCLK cycles the CPU is still busy with the instructions
+		 * it executed last. See `CPU::RunBlock`.
+		 */
+		size_t cpu_delay;
+		/**
+		 * SYSCLK cycles it takes to transfer control to a hardware interrupt
+		 * handler, added to `cpu_delay` by `AcceptInterrupt`. Same as `SWI`.
+		 */
+		static const size_t interrupt_entry_cycles = 3;
+
 		std::forward_list<Peripheral *> peripherals;
 
+		/**
+		 * The peripherals ticked by one clock, in the order of `peripherals`.
+		 * Each of them is only called once its idle ticks (see
+		 * `Peripheral::GetIdleTicks`) run out; `idle_ticks` of the list is the
+		 * minimum of those, so nothing has to be looked at before it runs out.
+		 * Skipped ticks are handed to the list first and to the entries when
+		 * the list is walked or flushed.
+		 */
+		struct ScheduledPeripheral
+		{
+			Peripheral *peripheral;
+			size_t idle_ticks, skipped_ticks;
+		};
+		struct TickList
+		{
+			std::vector<ScheduledPeripheral> entries;
+			size_t idle_ticks, skipped_ticks;
+		};
+		TickList tick_lists[CLOCK_STOPPED];
+		bool schedule_dirty;
+		uint8_t scheduled_LSCLK_output, scheduled_HSCLK_output;
+		void SchedulePeripherals();
+		void FlushSkippedTicks();
+		void TickPeripherals(TickList &list);
+		void SkipTicks(TickList &list, size_t ticks);
+
 		/**
 		 * A bunch of internally used methods for encapsulation purposes.
 		 */
@@ -84,7 +126,10 @@ namespace casioemu
 		Emulator &emulator;
 		CPU &cpu;
 		MMU &mmu;
-		std::vector<unsigned char> rom_data;
+		/**
+		 * Read-only, shared by all emulators that load the same ROM file.
+		 */
+		std::shared_ptr<const std::vector<unsigned char>> rom_data;
 
 		InterruptSource* MaskableInterrupts;
 		size_t EffectiveMICount;
@@ -92,6 +137,10 @@ namespace casioemu
 		//Reserve these pointers to make it easy for other peripherals to input to pins.
 		IOPorts* ioport;
 		ExternalInterrupts* EXIhandle;
+		// * Used by the C API to drive the emulator.
+		ScreenBase *screen;
+		Keyboard *keyboard;
+		BatteryBackedRAM *battery_backed_ram;
 
 		bool WDT_enabled = false;
 
@@ -132,6 +181,13 @@ namespace casioemu
 
 		bool EmuTimerSkipped;
 
+		/**
+		 * Number of times the CPU has run an instruction (a block of them
+		 * with `translate_blocks`), for noticing instruction boundaries. Not
+		 * part of the machine state.
+		 */
+		Uint64 instruction_count;
+
 		/**
 		 * This exists because the Emulator that owns this Chipset is not ready
 		 * to supply a ROM path upon construction. It has to call `LoadROM` later
@@ -143,6 +199,12 @@ namespace casioemu
 		 * See 1.3.7 in the nX-U8 manual.
 		 */
 		void Reset();
+		/**
+		 * Saves or restores the state of the chipset, the CPU and all
+		 * peripherals. The MMU has none of its own, memory belongs to the
+		 * peripherals that map it.
+		 */
+		void SerializeState(StateArchive &archive);
 		void Break();
 		void Halt();
 		void Stop();
@@ -155,11 +217,43 @@ namespace casioemu
 		void ResetMaskable(size_t index);
 		void SetInterruptPendingSFR(size_t index, bool val);
 		bool GetInterruptPendingSFR(size_t index);
+		/**
+		 * Drive a pin of port 0 or 1 from outside. Input goes through
+		 * `Emulator::Input` to be journaled, which then calls the `Apply`
+		 * variants.
+		 */
 		void InputToPort(int, int, bool);
 		void RemovePortInput(int, int);
+		void ApplyPortInput(int, int, bool);
+		void ApplyRemovePortInput(int, int);
+
+		/**
+		 * Hands all skipped ticks to the peripherals and has their idle ticks
+		 * recomputed before the next tick. Called before every SFR access, since
+		 * SFRs expose counters and may change what the peripherals are waiting for.
+		 */
+		void SyncPeripherals();
+		/**
+		 * Has the idle ticks of the peripherals recomputed before the next tick,
+		 * for state changes that don't go through SFRs (such as key presses).
+		 */
+		void InvalidateTickSchedule();
 
 		void Tick();
+		/**
+		 * While the CPU is halted or stopped, skips the cycles up to the next one
+		 * on which a peripheral or the clock generator has to do something, but
+		 * at most `max_cycles`. Returns the number of cycles skipped, which is 0
+		 * if the CPU is running or the next cycle can't be skipped; `Tick` has
+		 * to handle that cycle then.
+		 */
+		size_t SkipIdleCycles(size_t max_cycles);
 		bool GetRequireFrame();
+		/**
+		 * Publishes what the peripherals other than the screen draw, see
+		 * `Peripheral::Publish`.
+		 */
+		void PublishFrame();
 		void Frame();
 		void UIEvent(SDL_Event &event);
 
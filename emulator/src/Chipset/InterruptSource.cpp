@@ -2,6 +2,7 @@
 
 #include "../Emulator.hpp"
 #include "Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 namespace casioemu
 {
@@ -52,5 +53,9 @@ namespace casioemu
 		
 		emulator->chipset.ResetMaskable(interrupt_index);
 	}
-}
 
+	void InterruptSource::SerializeState(StateArchive &archive)
+	{
+		archive.Field(enabled);
+	}
+}
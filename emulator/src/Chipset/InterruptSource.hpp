@@ -4,6 +4,7 @@
 namespace casioemu
 {
 	class Emulator;
+	class StateArchive;
 
 	class InterruptSource
 	{
@@ -17,6 +18,7 @@ namespace casioemu
 		void TryRaise();
 		void ResetInt();
 		void SetEnabled(bool val);
+		void SerializeState(StateArchive &archive);
 	};
 }
 
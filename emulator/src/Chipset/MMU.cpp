@@ -1,45 +1,208 @@
 #include "MMU.hpp"
 
 #include <cstring>
+#include <algorithm>
 #include "../Emulator.hpp"
 #include "Chipset.hpp"
 #include "../Logger.hpp"
-#include "../Gui/ui.hpp"
 #include "CPU.hpp"
 
 namespace casioemu
 {
 	MMU::MMU(Emulator &_emulator) : emulator(_emulator)
 	{
-		segment_dispatch = new MemoryByte *[0x100];
+		segment_pages = new MemoryPage *[0x100];
 		for (size_t ix = 0; ix != 0x100; ++ix)
-			segment_dispatch[ix] = nullptr;
+			segment_pages[ix] = nullptr;
+		fast_segment_limit = 0;
+		watch_log_next = 0;
 	}
 
 	MMU::~MMU()
 	{
 		for (size_t ix = 0; ix != 0x100; ++ix)
-			if (segment_dispatch[ix])
-				delete[] segment_dispatch[ix];
+		{
+			if (!segment_pages[ix])
+				continue;
+			for (size_t px = 0; px != 0x10000 / page_size; ++px)
+			{
+				delete[] segment_pages[ix][px].byte_regions;
+				delete[] segment_pages[ix][px].watch_bits;
+			}
+			delete[] segment_pages[ix];
+		}
 
-		delete[] segment_dispatch;
+		delete[] segment_pages;
 	}
 
 	void MMU::GenerateSegmentDispatch(size_t segment_index)
 	{
-		segment_dispatch[segment_index] = new MemoryByte[0x10000];
-		for (size_t ix = 0; ix != 0x10000; ++ix)
+		segment_pages[segment_index] = new MemoryPage[0x10000 / page_size];
+		for (size_t ix = 0; ix != 0x10000 / page_size; ++ix)
+		{
+			MemoryPage &page = segment_pages[segment_index][ix];
+			page.region = nullptr;
+			page.byte_regions = nullptr;
+			page.read_data = nullptr;
+			page.write_data = nullptr;
+			page.watch_bits = nullptr;
+		}
+	}
+
+	MMU::MemoryPage *MMU::GetPage(size_t offset)
+	{
+		if (offset >= (1 << 24))
+			return nullptr;
+		MemoryPage *segment = segment_pages[offset >> 16];
+		if (!segment)
+			return nullptr;
+		return &segment[(offset & 0xFFFF) / page_size];
+	}
+
+	MMURegion *MMU::GetRegion(MemoryPage &page, size_t offset)
+	{
+		return page.byte_regions ? page.byte_regions[offset % page_size] : page.region;
+	}
+
+	bool MMU::SetWatch(size_t offset, WatchAccess access, const WatchPoint *watch)
+	{
+		MemoryPage *page = GetPage(offset);
+		if (!page)
+		{
+			if (watch)
+				luaL_unref(emulator.lua_state, LUA_REGISTRYINDEX, watch->function);
+			return false;
+		}
+
+		auto existing = watches[access].find(offset);
+		if (existing != watches[access].end())
 		{
-			segment_dispatch[segment_index][ix].region = nullptr;
-			segment_dispatch[segment_index][ix].on_read = LUA_REFNIL;
-			segment_dispatch[segment_index][ix].on_write = LUA_REFNIL;
+			luaL_unref(emulator.lua_state, LUA_REGISTRYINDEX, existing->second.function);
+			watches[access].erase(existing);
 		}
+
+		size_t bit = access * page_size + offset % page_size;
+		if (watch)
+		{
+			watches[access][offset] = *watch;
+			if (!page->watch_bits)
+				page->watch_bits = new uint64_t[2 * page_size / 64]();
+			page->watch_bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+			return true;
+		}
+
+		if (!page->watch_bits)
+			return true;
+		page->watch_bits[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+		for (size_t ix = 0; ix != 2 * page_size / 64; ++ix)
+			if (page->watch_bits[ix])
+				return true;
+		delete[] page->watch_bits;
+		page->watch_bits = nullptr;
+		return true;
+	}
+
+	const MMU::WatchPoint *MMU::GetWatch(size_t offset, WatchAccess access)
+	{
+		auto watch = watches[access].find(offset);
+		return watch == watches[access].end() ? nullptr : &watch->second;
+	}
+
+	void MMU::TriggerWatch(size_t offset, WatchAccess access, uint8_t old_value, uint8_t new_value)
+	{
+		// * These accesses already triggered the first time round.
+		if (emulator.rewinding)
+			return;
+		auto it = watches[access].find(offset);
+		if (it == watches[access].end())
+			return;
+		WatchPoint &watch = it->second;
+
+		if (watch.kinds & WK_MATCH && (new_value & watch.mask) != watch.value)
+			return;
+
+		if (watch.kinds & WK_COUNT)
+			watch.hits++;
+
+		if (watch.kinds & WK_LOG)
+		{
+			CPU &cpu = emulator.chipset.cpu;
+			WatchLogEntry entry{offset, ((size_t)cpu.reg_csr << 16) | cpu.reg_pc, old_value, new_value, access};
+			if (watch_log.size() < watch_log_size)
+				watch_log.push_back(entry);
+			else
+				watch_log[watch_log_next] = entry;
+			watch_log_next = (watch_log_next + 1) % watch_log_size;
+		}
+
+		if (watch.kinds & WK_BREAK)
+			emulator.SetPaused(true);
+
+		if (watch.function != LUA_REFNIL)
+		{
+			// * The callback may remove the watch, so `watch` must not be used afterwards.
+			lua_geti(emulator.lua_state, LUA_REGISTRYINDEX, watch.function);
+			lua_pushinteger(emulator.lua_state, offset);
+			lua_pushinteger(emulator.lua_state, old_value);
+			lua_pushinteger(emulator.lua_state, new_value);
+			if (lua_pcall(emulator.lua_state, 3, 0, 0) != LUA_OK)
+			{
+				logger::Info("calling commands on %s at %06zX failed: %s\n",
+						access == WATCH_READ ? "rwatch" : "watch", offset, lua_tostring(emulator.lua_state, -1));
+				lua_pop(emulator.lua_state, 1);
+			}
+		}
+	}
+
+	std::vector<MMU::WatchLogEntry> MMU::GetWatchLog()
+	{
+		std::vector<WatchLogEntry> log;
+		size_t first = watch_log.size() < watch_log_size ? 0 : watch_log_next;
+		for (size_t ix = 0; ix != watch_log.size(); ++ix)
+			log.push_back(watch_log[(first + ix) % watch_log.size()]);
+		return log;
+	}
+
+	void MMU::ClearWatchLog()
+	{
+		watch_log.clear();
+		watch_log_next = 0;
+	}
+
+	static int SetLuaWatch(lua_State *lua_state, MMU::WatchAccess access, const char *name)
+	{
+		if (lua_gettop(lua_state) != 3)
+			return luaL_error(lua_state, "%s function called with incorrect number of arguments", name);
+
+		MMU *mmu = *(MMU **)lua_topointer(lua_state, 1);
+		size_t offset = lua_tointeger(lua_state, 2);
+		MMU::WatchPoint watch{0, 0, 0, 0, luaL_ref(lua_state, LUA_REGISTRYINDEX)};
+
+		if (!mmu->SetWatch(offset, access, watch.function == LUA_REFNIL ? nullptr : &watch))
+			logger::Info("attempt to set %s from offset %04zX of unmapped segment %02zX\n",
+					name, offset & 0xFFFF, offset >> 16);
+		return 0;
+	}
+
+	static MMU::WatchAccess ToWatchAccess(lua_State *lua_state, int index)
+	{
+		const char *access = luaL_checkstring(lua_state, index);
+		if (std::strcmp(access, "r") == 0)
+			return MMU::WATCH_READ;
+		if (std::strcmp(access, "w") != 0)
+			luaL_error(lua_state, "watch access must be \"r\" or \"w\"");
+		return MMU::WATCH_WRITE;
 	}
 
 	void MMU::SetupInternals()
 	{
-		me_mmu = this;
 		real_hardware = emulator.GetModelInfo("real_hardware");
+		if (real_hardware && emulator.hardware_id == HW_CLASSWIZ_II)
+			fast_segment_limit = 0x10;
+		else if (real_hardware && emulator.hardware_id == HW_CLASSWIZ)
+			fast_segment_limit = 4;
+		else
+			fast_segment_limit = 0x100;
 
 		emulator.chipset.SegmentAccess = false;
 
@@ -76,56 +239,104 @@ namespace casioemu
 			{
 				// execute Lua function whenever address is read from
 				lua_pushcfunction(lua_state, [](lua_State *lua_state) {
-					if (lua_gettop(lua_state) != 3)
-						return luaL_error(lua_state, "rwatch function called with incorrect number of arguments");
-
+					return SetLuaWatch(lua_state, WATCH_READ, "rwatch");
+				});
+				return 1;
+			}
+			else if (std::strcmp(key, "watch") == 0)
+			{
+				// execute Lua function whenever address is written to
+				lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+					return SetLuaWatch(lua_state, WATCH_WRITE, "watch");
+				});
+				return 1;
+			}
+			else if (std::strcmp(key, "watchpoint") == 0)
+			{
+				// data:watchpoint(addr, "r" or "w", {pause=, log=, count=, value=, mask=, callback=})
+				// removes the watch if the table is nil
+				lua_pushcfunction(lua_state, [](lua_State *lua_state) {
 					MMU *mmu = *(MMU **)lua_topointer(lua_state, 1);
-					size_t offset = lua_tointeger(lua_state, 2);
-					int on_read = luaL_ref(lua_state, LUA_REGISTRYINDEX);
-
-					size_t segment_index = offset >> 16;
-					size_t segment_offset = offset & 0xFFFF;
-
-					MemoryByte *segment = mmu->segment_dispatch[segment_index];
-					if (!segment)
+					size_t offset = luaL_checkinteger(lua_state, 2);
+					WatchAccess access = ToWatchAccess(lua_state, 3);
+					if (lua_isnoneornil(lua_state, 4))
 					{
-						logger::Info("attempt to set rwatch from offset %04zX of unmapped segment %02zX\n",
-								segment_offset, segment_index);
+						mmu->SetWatch(offset, access, nullptr);
 						return 0;
 					}
+					luaL_checktype(lua_state, 4, LUA_TTABLE);
+
+					WatchPoint watch;
+					watch.kinds = 0;
+					watch.value = 0;
+					watch.mask = 0xFF;
+					watch.hits = 0;
+					if (lua_getfield(lua_state, 4, "pause") != LUA_TNIL && lua_toboolean(lua_state, -1))
+						watch.kinds |= WK_BREAK;
+					if (lua_getfield(lua_state, 4, "log") != LUA_TNIL && lua_toboolean(lua_state, -1))
+						watch.kinds |= WK_LOG;
+					if (lua_getfield(lua_state, 4, "count") != LUA_TNIL && lua_toboolean(lua_state, -1))
+						watch.kinds |= WK_COUNT;
+					if (lua_getfield(lua_state, 4, "mask") != LUA_TNIL)
+						watch.mask = lua_tointeger(lua_state, -1);
+					if (lua_getfield(lua_state, 4, "value") != LUA_TNIL)
+					{
+						watch.kinds |= WK_MATCH;
+						watch.value = lua_tointeger(lua_state, -1) & watch.mask;
+					}
+					lua_pop(lua_state, 5);
+					lua_getfield(lua_state, 4, "callback");
+					watch.function = luaL_ref(lua_state, LUA_REGISTRYINDEX);
 
-					MemoryByte &byte = segment[segment_offset];
-					luaL_unref(lua_state, LUA_REGISTRYINDEX, byte.on_read);
-					byte.on_read = on_read;
+					if (!mmu->SetWatch(offset, access, &watch))
+						logger::Info("attempt to set watchpoint from offset %04zX of unmapped segment %02zX\n",
+								offset & 0xFFFF, offset >> 16);
 					return 0;
 				});
 				return 1;
 			}
-			else if (std::strcmp(key, "watch") == 0)
+			else if (std::strcmp(key, "watch_hits") == 0)
 			{
-				// execute Lua function whenever address is written to
 				lua_pushcfunction(lua_state, [](lua_State *lua_state) {
-					if (lua_gettop(lua_state) != 3)
-						return luaL_error(lua_state, "watch function called with incorrect number of arguments");
-
 					MMU *mmu = *(MMU **)lua_topointer(lua_state, 1);
-					size_t offset = lua_tointeger(lua_state, 2);
-					int on_write = luaL_ref(lua_state, LUA_REGISTRYINDEX);
-
-					size_t segment_index = offset >> 16;
-					size_t segment_offset = offset & 0xFFFF;
-
-					MemoryByte *segment = mmu->segment_dispatch[segment_index];
-					if (!segment)
-					{
-						logger::Info("attempt to set watch from offset %04zX of unmapped segment %02zX\n",
-								segment_offset, segment_index);
+					const WatchPoint *watch = mmu->GetWatch(luaL_checkinteger(lua_state, 2), ToWatchAccess(lua_state, 3));
+					if (!watch)
 						return 0;
+					lua_pushinteger(lua_state, watch->hits);
+					return 1;
+				});
+				return 1;
+			}
+			else if (std::strcmp(key, "watch_log") == 0)
+			{
+				lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+					MMU *mmu = *(MMU **)lua_topointer(lua_state, 1);
+					std::vector<WatchLogEntry> log = mmu->GetWatchLog();
+					lua_createtable(lua_state, log.size(), 0);
+					for (size_t ix = 0; ix != log.size(); ++ix)
+					{
+						lua_createtable(lua_state, 0, 5);
+						lua_pushinteger(lua_state, log[ix].offset);
+						lua_setfield(lua_state, -2, "addr");
+						lua_pushinteger(lua_state, log[ix].pc);
+						lua_setfield(lua_state, -2, "pc");
+						lua_pushinteger(lua_state, log[ix].old_value);
+						lua_setfield(lua_state, -2, "old");
+						lua_pushinteger(lua_state, log[ix].new_value);
+						lua_setfield(lua_state, -2, "new");
+						lua_pushboolean(lua_state, log[ix].access == WATCH_WRITE);
+						lua_setfield(lua_state, -2, "write");
+						lua_seti(lua_state, -2, ix + 1);
 					}
-
-					MemoryByte &byte = segment[segment_offset];
-					luaL_unref(lua_state, LUA_REGISTRYINDEX, byte.on_write);
-					byte.on_write = on_write;
+					return 1;
+				});
+				return 1;
+			}
+			else if (std::strcmp(key, "clear_watch_log") == 0)
+			{
+				lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+					MMU *mmu = *(MMU **)lua_topointer(lua_state, 1);
+					mmu->ClearWatchLog();
 					return 0;
 				});
 				return 1;
@@ -138,7 +349,11 @@ namespace casioemu
 		lua_setfield(emulator.lua_state, -2, "__index");
 		lua_pushcfunction(emulator.lua_state, [](lua_State *lua_state) {
 			MMU *mmu = *(MMU **)lua_topointer(lua_state, 1);
-			mmu->WriteData(lua_tointeger(lua_state, 2), lua_tointeger(lua_state, 3));
+			Emulator::InputEvent input(Emulator::InputEvent::IE_WRITE_DATA);
+			input.address = lua_tointeger(lua_state, 2);
+			input.value = true;
+			input.data.push_back(lua_tointeger(lua_state, 3));
+			mmu->emulator.Input(input);
 			return 0;
 		});
 		lua_setfield(emulator.lua_state, -2, "__newindex");
@@ -153,8 +368,8 @@ namespace casioemu
 		if (offset & 1)
 			PANIC("offset has LSB set\n");
 
-		if(offset < emulator.chipset.rom_data.size())
-			return (((uint16_t)emulator.chipset.rom_data[offset + 1]) << 8) | emulator.chipset.rom_data[offset];
+		if(offset < emulator.chipset.rom_data->size())
+			return (((uint16_t)(*emulator.chipset.rom_data)[offset + 1]) << 8) | (*emulator.chipset.rom_data)[offset];
 		
 		if(real_hardware)
 			return 0xFFFF;
@@ -183,7 +398,7 @@ namespace casioemu
 		// return (((uint16_t)region->read(region, offset + 1)) << 8) | region->read(region, offset);
 	}
 
-	uint8_t MMU::ReadData(size_t offset, bool softwareRead)
+	uint8_t MMU::ReadDataSlow(size_t offset, bool softwareRead)
 	{
 		if (offset >= (1 << 24))
 			PANIC("offset doesn't fit 24 bits\n");
@@ -220,26 +435,18 @@ namespace casioemu
 				return 0;
 		}
 
-		MemoryByte *segment = segment_dispatch[segment_index];
-		if (!segment)
+		MemoryPage *page = GetPage(offset);
+		if (!page)
 		{
 			//logger::Info("read from offset %04zX of unmapped segment %02zX\n", segment_offset, segment_index);
 			emulator.HandleMemoryError();
 			return 0;
 		}
 
-		MemoryByte &byte = segment[segment_offset];
-		MMURegion *region = byte.region;
-		if (byte.on_read != LUA_REFNIL && softwareRead)
-		{
-			lua_geti(emulator.lua_state, LUA_REGISTRYINDEX, byte.on_read);
-			if (lua_pcall(emulator.lua_state, 0, 0, 0) != LUA_OK)
-			{
-				//logger::Info("calling commands on rwatch at %06zX failed: %s\n",
-						//offset, lua_tostring(emulator.lua_state, -1));
-				lua_pop(emulator.lua_state, 1);
-			}
-		}
+		if (page->read_data && !page->watch_bits)
+			return page->read_data[offset % page_size];
+
+		MMURegion *region = GetRegion(*page, offset);
 		if (!region)
 		{
 			//logger::Info("read from unmapped offset %04zX of segment %02zX\n", segment_offset, segment_index);
@@ -247,10 +454,23 @@ namespace casioemu
 			return 0;
 		}
 
-		return region->read(region, offset);
+		uint8_t value;
+		// * Plain memory in pages shared with SFRs or with watches.
+		if (region->data)
+			value = region->data[offset - region->base];
+		else
+		{
+			if (!segment_index && segment_offset >= 0xF000 && segment_offset < 0xF800)
+				emulator.chipset.SyncPeripherals();
+			value = region->read(region, offset);
+		}
+
+		if (softwareRead && IsWatched(*page, offset, WATCH_READ))
+			TriggerWatch(offset, WATCH_READ, value, value);
+		return value;
 	}
 
-	void MMU::WriteData(size_t offset, uint8_t data, bool softwareWrite)
+	void MMU::WriteDataSlow(size_t offset, uint8_t data, bool softwareWrite)
 	{
 		if (offset >= (1 << 24))
 			PANIC("offset doesn't fit 24 bits\n");
@@ -258,26 +478,21 @@ namespace casioemu
 		size_t segment_index = offset >> 16;
 		size_t segment_offset = offset & 0xFFFF;
 
-		MemoryByte *segment = segment_dispatch[segment_index];
-		if (!segment)
+		MemoryPage *page = GetPage(offset);
+		if (!page)
 		{
 			//logger::Info("write to offset %04zX of unmapped segment %02zX (%02zX)\n", segment_offset, segment_index, data);
 			emulator.HandleMemoryError();
 			return;
 		}
 
-		MemoryByte &byte = segment[segment_offset];
-		MMURegion *region = byte.region;
-		if (byte.on_write != LUA_REFNIL && softwareWrite)
+		if (page->write_data && !page->watch_bits)
 		{
-			lua_geti(emulator.lua_state, LUA_REGISTRYINDEX, byte.on_write);
-			if (lua_pcall(emulator.lua_state, 0, 0, 0) != LUA_OK)
-			{
-				logger::Info("calling commands on watch at %06zX failed: %s\n",
-						offset, lua_tostring(emulator.lua_state, -1));
-				lua_pop(emulator.lua_state, 1);
-			}
+			page->write_data[offset % page_size] = data;
+			return;
 		}
+
+		MMURegion *region = GetRegion(*page, offset);
 		if (!region)
 		{
 			//logger::Info("write to unmapped offset %04zX of segment %02zX (%02zX)\n", segment_offset, segment_index, data);
@@ -285,7 +500,71 @@ namespace casioemu
 			return;
 		}
 
-		region->write(region, offset, data);
+		bool watched = softwareWrite && IsWatched(*page, offset, WATCH_WRITE);
+		uint8_t old_value = 0;
+		if (region->data_writable)
+		{
+			if (watched)
+				old_value = region->data[offset - region->base];
+			region->data[offset - region->base] = data;
+		}
+		else
+		{
+			if (!segment_index && segment_offset >= 0xF000 && segment_offset < 0xF800)
+				emulator.chipset.SyncPeripherals();
+			// * The old value of SFRs is read back through the region, which is
+			// * only done when the byte is watched.
+			if (watched)
+				old_value = region->data ? region->data[offset - region->base] : region->read(region, offset);
+			region->write(region, offset, data);
+		}
+
+		if (watched)
+			TriggerWatch(offset, WATCH_WRITE, old_value, data);
+	}
+
+	bool MMU::PeekData(size_t offset, uint8_t &value)
+	{
+		// * Segments past `fast_segment_limit` have special cases on real hardware.
+		if ((offset >> 16) >= fast_segment_limit)
+			return false;
+		MemoryPage *page = GetPage(offset);
+		if (!page)
+			return false;
+		if (page->read_data)
+		{
+			value = page->read_data[offset % page_size];
+			return true;
+		}
+
+		MMURegion *region = GetRegion(*page, offset);
+		if (!region || !region->data)
+			return false;
+		value = region->data[offset - region->base];
+		return true;
+	}
+
+	uint8_t *MMU::GetSpan(size_t offset, size_t length, bool write)
+	{
+		size_t last = offset + length - 1;
+		if ((offset >> 16) >= fast_segment_limit || (last >> 16) != (offset >> 16))
+			return nullptr;
+
+		MemoryPage *page = GetPage(offset);
+		if (!page || page->watch_bits)
+			return nullptr;
+
+		// * Spans within one page of plain memory need no region lookup.
+		if (offset / page_size == last / page_size && (write ? page->write_data : page->read_data))
+			return (write ? page->write_data : page->read_data) + offset % page_size;
+
+		if (GetPage(last)->watch_bits)
+			return nullptr;
+
+		MMURegion *region = GetRegion(*page, offset);
+		if (!region || !region->data || (write && !region->data_writable) || last >= region->base + region->size)
+			return nullptr;
+		return region->data + (offset - region->base);
 	}
 
 	size_t MMU::getRealOffset(size_t offset) {
@@ -306,21 +585,71 @@ namespace casioemu
 
 	void MMU::RegisterRegion(MMURegion *region)
 	{
-		for (size_t ix = region->base; ix != region->base + region->size; ++ix)
+		size_t end = region->base + region->size;
+		for (size_t page_base = region->base & ~(page_size - 1); page_base < end; page_base += page_size)
 		{
-			if (segment_dispatch[ix >> 16][ix & 0xFFFF].region)
-				PANIC("MMU region overlap at %06zX\n", ix);
-			segment_dispatch[ix >> 16][ix & 0xFFFF].region = region;
+			MemoryPage *page = GetPage(page_base);
+			if (!page)
+				PANIC("MMU region in unmapped segment at %06zX\n", page_base);
+
+			size_t begin = std::max(page_base, region->base), stop = std::min(page_base + page_size, end);
+			if (begin == page_base && stop == page_base + page_size && !page->region && !page->byte_regions)
+			{
+				page->region = region;
+				page->read_data = region->data ? region->data + (page_base - region->base) : nullptr;
+				page->write_data = region->data_writable ? page->read_data : nullptr;
+				continue;
+			}
+
+			// * The page is shared with other regions from now on.
+			if (!page->byte_regions)
+			{
+				page->byte_regions = new MMURegion *[page_size];
+				std::fill_n(page->byte_regions, page_size, page->region);
+				page->region = nullptr;
+				page->read_data = nullptr;
+				page->write_data = nullptr;
+			}
+			for (size_t ix = begin; ix != stop; ++ix)
+			{
+				if (page->byte_regions[ix % page_size])
+					PANIC("MMU region overlap at %06zX\n", ix);
+				page->byte_regions[ix % page_size] = region;
+			}
 		}
 	}
 
 	void MMU::UnregisterRegion(MMURegion *region)
 	{
-		for (size_t ix = region->base; ix != region->base + region->size; ++ix)
+		size_t end = region->base + region->size;
+		for (size_t page_base = region->base & ~(page_size - 1); page_base < end; page_base += page_size)
 		{
-			if (!segment_dispatch[ix >> 16][ix & 0xFFFF].region)
-				PANIC("MMU region double-hole at %06zX\n", ix);
-			segment_dispatch[ix >> 16][ix & 0xFFFF].region = nullptr;
+			MemoryPage *page = GetPage(page_base);
+			if (page && page->region == region)
+			{
+				page->region = nullptr;
+				page->read_data = nullptr;
+				page->write_data = nullptr;
+				continue;
+			}
+
+			size_t begin = std::max(page_base, region->base), stop = std::min(page_base + page_size, end);
+			if (!page || !page->byte_regions)
+				PANIC("MMU region double-hole at %06zX\n", begin);
+			for (size_t ix = begin; ix != stop; ++ix)
+			{
+				if (page->byte_regions[ix % page_size] != region)
+					PANIC("MMU region double-hole at %06zX\n", ix);
+				page->byte_regions[ix % page_size] = nullptr;
+			}
+
+			if (std::all_of(page->byte_regions, page->byte_regions + page_size, [](MMURegion *byte_region) {
+				return !byte_region;
+			}))
+			{
+				delete[] page->byte_regions;
+				page->byte_regions = nullptr;
+			}
 		}
 	}
 }
@@ -5,6 +5,8 @@
 
 #include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace casioemu
 {
@@ -17,16 +19,89 @@ namespace casioemu
 
 		bool real_hardware;
 
-		struct MemoryByte
+		static const size_t page_size = 0x100;
+
+		/**
+		 * Dispatch information for `page_size` bytes of memory. Most pages
+		 * belong to a single region; pages shared by several regions (SFRs)
+		 * get a region pointer per byte instead.
+		 */
+		struct MemoryPage
 		{
 			MMURegion *region;
+			MMURegion **byte_regions;
+			/**
+			 * The bytes of the page if its region is backed by a plain array
+			 * (see `MMURegion::data`), which are then accessed directly.
+			 * `write_data` is nullptr for read-only regions.
+			 */
+			uint8_t *read_data, *write_data;
 			/**
-			 * Lua index to a function to execute when this byte is read from
-			 * or written to as data. If this is LUA_REFNIL, no function is executed.
+			 * Bitmap of watched bytes, `page_size` bits for reads followed by
+			 * `page_size` bits for writes. nullptr if nothing in this page is
+			 * watched; accesses to pages with watches always take the slow path.
 			 */
-			int on_read, on_write;
+			uint64_t *watch_bits;
 		};
-		MemoryByte **segment_dispatch;
+		MemoryPage **segment_pages;
+
+		/**
+		 * Segments below this one can take the inline fast path of `ReadData`
+		 * and `WriteData`. Segments above it have special cases on real
+		 * hardware (see `ReadDataSlow`).
+		 */
+		size_t fast_segment_limit;
+
+	public:
+		enum WatchAccess
+		{
+			WATCH_READ,
+			WATCH_WRITE
+		};
+
+		enum WatchKind
+		{
+			WK_BREAK = 1, // * Pause the emulator.
+			WK_LOG = 2,   // * Record the access in the watch log.
+			WK_COUNT = 4, // * Count hits.
+			WK_MATCH = 8  // * Only trigger if (new value & mask) == value.
+		};
+
+		struct WatchPoint
+		{
+			unsigned int kinds;
+			uint8_t value, mask;
+			size_t hits;
+			/**
+			 * Lua index to a function to call with the address, the old and the
+			 * new value of the byte when the watch triggers. LUA_REFNIL if none.
+			 */
+			int function;
+		};
+
+		struct WatchLogEntry
+		{
+			size_t offset, pc;
+			uint8_t old_value, new_value;
+			WatchAccess access;
+		};
+
+	private:
+		std::unordered_map<size_t, WatchPoint> watches[2];
+
+		static const size_t watch_log_size = 1024;
+		std::vector<WatchLogEntry> watch_log;
+		size_t watch_log_next;
+
+		MemoryPage *GetPage(size_t offset);
+		MMURegion *GetRegion(MemoryPage &page, size_t offset);
+
+		inline bool IsWatched(MemoryPage &page, size_t offset, WatchAccess access)
+		{
+			size_t bit = access * page_size + offset % page_size;
+			return page.watch_bits && (page.watch_bits[bit / 64] >> (bit % 64) & 1);
+		}
+		void TriggerWatch(size_t offset, WatchAccess access, uint8_t old_value, uint8_t new_value);
 
 	public:
 		MMU(Emulator &emulator);
@@ -34,8 +109,128 @@ namespace casioemu
 		void SetupInternals();
 		void GenerateSegmentDispatch(size_t segment_index);
 		uint16_t ReadCode(size_t offset);
-		uint8_t ReadData(size_t offset, bool softwareRead = true);
-		void WriteData(size_t offset, uint8_t data, bool softwareWrite = true);
+		uint8_t ReadDataSlow(size_t offset, bool softwareRead);
+		void WriteDataSlow(size_t offset, uint8_t data, bool softwareWrite);
+
+		inline uint8_t ReadData(size_t offset, bool softwareRead = true)
+		{
+			if ((offset >> 16) < fast_segment_limit && segment_pages[offset >> 16])
+			{
+				MemoryPage &page = segment_pages[offset >> 16][(offset & 0xFFFF) / page_size];
+				if (page.read_data && !page.watch_bits)
+					return page.read_data[offset % page_size];
+			}
+			return ReadDataSlow(offset, softwareRead);
+		}
+
+		inline void WriteData(size_t offset, uint8_t data, bool softwareWrite = true)
+		{
+			if ((offset >> 16) < fast_segment_limit && segment_pages[offset >> 16])
+			{
+				MemoryPage &page = segment_pages[offset >> 16][(offset & 0xFFFF) / page_size];
+				if (page.write_data && !page.watch_bits)
+				{
+					page.write_data[offset % page_size] = data;
+					return;
+				}
+			}
+			WriteDataSlow(offset, data, softwareWrite);
+		}
+
+		/**
+		 * Reads the byte at `offset` into `value` if it's plain memory (see
+		 * `MMURegion::data`), without calling read handlers, triggering
+		 * watches or reporting memory errors. Returns false for SFRs and
+		 * unmapped bytes, which can't be read without side effects.
+		 */
+		bool PeekData(size_t offset, uint8_t &value);
+
+		/**
+		 * Returns a pointer to the `length` bytes at `offset` if they are plain
+		 * memory of a single region (see `MMURegion::data`) without watches,
+		 * so that they can be accessed in one go. Returns nullptr otherwise,
+		 * in which case the bytes have to be accessed one by one.
+		 */
+		uint8_t *GetSpan(size_t offset, size_t length, bool write);
+
+		/**
+		 * Little-endian accesses of `length` (at most 8) bytes. Like the CPU's
+		 * data accesses, the bytes wrap around within the segment of `offset`.
+		 * Spans inside one plain memory region are accessed in one go;
+		 * anything else goes through `ReadData`/`WriteData` byte by byte, with
+		 * writes going from the highest byte to the lowest like the CPU's.
+		 */
+		inline uint64_t ReadMulti(size_t offset, size_t length)
+		{
+			uint64_t value = 0;
+			if (uint8_t *span = GetSpan(offset, length, false))
+			{
+				for (size_t ix = 0; ix != length; ++ix)
+					value |= ((uint64_t)span[ix]) << (8 * ix);
+				return value;
+			}
+
+			for (size_t ix = 0; ix != length; ++ix)
+				value |= ((uint64_t)ReadData((offset & ~0xFFFF) | (uint16_t)(offset + ix))) << (8 * ix);
+			return value;
+		}
+
+		inline void WriteMulti(size_t offset, uint64_t value, size_t length)
+		{
+			if (uint8_t *span = GetSpan(offset, length, true))
+			{
+				for (size_t ix = 0; ix != length; ++ix)
+					span[ix] = value >> (8 * ix);
+				return;
+			}
+
+			for (size_t ix = length - 1; ix != (size_t)-1; --ix)
+				WriteData((offset & ~0xFFFF) | (uint16_t)(offset + ix), value >> (8 * ix));
+		}
+
+		uint16_t Read16(size_t offset)
+		{
+			return ReadMulti(offset, 2);
+		}
+
+		uint32_t Read32(size_t offset)
+		{
+			return ReadMulti(offset, 4);
+		}
+
+		uint64_t Read64(size_t offset)
+		{
+			return ReadMulti(offset, 8);
+		}
+
+		void Write16(size_t offset, uint16_t value)
+		{
+			WriteMulti(offset, value, 2);
+		}
+
+		void Write32(size_t offset, uint32_t value)
+		{
+			WriteMulti(offset, value, 4);
+		}
+
+		void Write64(size_t offset, uint64_t value)
+		{
+			WriteMulti(offset, value, 8);
+		}
+
+		/**
+		 * Sets the watch for `access` on the byte at `offset`, or removes it if
+		 * `watch` is nullptr. Takes over the Lua reference in `watch->function`.
+		 * Returns false if the offset is not mapped.
+		 */
+		bool SetWatch(size_t offset, WatchAccess access, const WatchPoint *watch);
+		const WatchPoint *GetWatch(size_t offset, WatchAccess access);
+		/**
+		 * Returns the logged accesses (see `WK_LOG`), oldest first. Only the
+		 * last `watch_log_size` accesses are kept.
+		 */
+		std::vector<WatchLogEntry> GetWatchLog();
+		void ClearWatchLog();
 		size_t getRealOffset(size_t offset);
 
 		void RegisterRegion(MMURegion *region);
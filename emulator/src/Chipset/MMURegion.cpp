@@ -29,6 +29,27 @@ namespace casioemu
 		userdata = _userdata;
 		read = _read;
 		write = _write;
+		data = nullptr;
+		data_writable = false;
+
+		emulator->chipset.mmu.RegisterRegion(this);
+		setup_done = true;
+	}
+
+	void MMURegion::Setup(size_t _base, size_t _size, std::string _description, uint8_t *_data, LinearAccess access, Emulator &_emulator, WriteFunction _write)
+	{
+		if (setup_done)
+			PANIC("Setup invoked twice\n");
+
+		emulator = &_emulator;
+		base = _base;
+		size = _size;
+		description = _description;
+		userdata = _data;
+		read = LinearRead;
+		write = access == LA_READ_WRITE ? LinearWrite : _write;
+		data = _data;
+		data_writable = access == LA_READ_WRITE;
 
 		emulator->chipset.mmu.RegisterRegion(this);
 		setup_done = true;
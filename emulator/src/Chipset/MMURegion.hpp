@@ -20,6 +20,20 @@ namespace casioemu
 		void *userdata;
 		ReadFunction read;
 		WriteFunction write;
+		enum LinearAccess
+		{
+			LA_READ_ONLY,
+			LA_READ_WRITE
+		};
+
+		/**
+		 * The bytes of the region if it's a plain byte array, nullptr otherwise.
+		 * The MMU reads those directly instead of calling `read`, and writes
+		 * them directly too unless the region is read-only, in which case
+		 * writes still go to `write`.
+		 */
+		uint8_t *data;
+		bool data_writable;
 		bool setup_done;
 		Emulator *emulator;
 
@@ -33,6 +47,7 @@ namespace casioemu
 		MMURegion &operator=(MMURegion &&) = delete;
 		~MMURegion();
 		void Setup(size_t base, size_t size, std::string description, void *userdata, ReadFunction read, WriteFunction write, Emulator &emulator);
+		void Setup(size_t base, size_t size, std::string description, uint8_t *data, LinearAccess access, Emulator &emulator, WriteFunction write = IgnoreWrite);
 		void Kill();
 
 		template<uint8_t read_value>
@@ -45,6 +60,16 @@ namespace casioemu
 		{
 		}
 
+		static uint8_t LinearRead(MMURegion *region, size_t offset)
+		{
+			return region->data[offset - region->base];
+		}
+
+		static void LinearWrite(MMURegion *region, size_t offset, uint8_t data)
+		{
+			region->data[offset - region->base] = data;
+		}
+
 		template<typename value_type, value_type mask = (value_type)-1>
 		static uint8_t DefaultRead(MMURegion *region, size_t offset)
 		{
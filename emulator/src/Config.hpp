@@ -14,4 +14,3 @@
 		)
 
 #define MODEL_DEF_NAME "model.def"
-
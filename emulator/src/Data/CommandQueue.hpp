@@ -0,0 +1,76 @@
+#pragma once
+#include "../Config.hpp"
+
+#include <atomic>
+#include <functional>
+
+namespace casioemu
+{
+	/**
+	 * Commands for the thread that owns an emulator. Any number of threads may
+	 * `Push` without taking a lock; only one thread at a time may `Pop`
+	 * (`Emulator` pops on its tick thread, or with `access_mx` held once
+	 * there is none).
+	 *
+	 * The queue is a linked list with a dummy node at `tail`. Producers swap
+	 * themselves in at `head` and then link the previous head to their node,
+	 * so a command may be invisible to `Pop` for a moment after it's pushed;
+	 * it's popped the next time then.
+	 */
+	class CommandQueue
+	{
+		struct Node
+		{
+			std::function<void()> command;
+			std::atomic<Node *> next;
+
+			Node() : next(nullptr)
+			{
+			}
+		};
+
+		std::atomic<Node *> head;
+		Node *tail;
+
+	public:
+		CommandQueue() : head(new Node), tail(head.load())
+		{
+		}
+
+		~CommandQueue()
+		{
+			while (tail)
+			{
+				Node *next = tail->next.load();
+				delete tail;
+				tail = next;
+			}
+		}
+
+		CommandQueue(const CommandQueue &) = delete;
+		CommandQueue &operator=(const CommandQueue &) = delete;
+
+		void Push(std::function<void()> command)
+		{
+			Node *node = new Node;
+			node->command = std::move(command);
+			head.exchange(node)->next.store(node);
+		}
+
+		bool Pop(std::function<void()> &command)
+		{
+			Node *next = tail->next.load();
+			if (!next)
+				return false;
+			command = std::move(next->command);
+			delete tail;
+			tail = next;
+			return true;
+		}
+
+		bool Empty()
+		{
+			return !tail->next.load();
+		}
+	};
+}
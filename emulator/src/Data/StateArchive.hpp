@@ -0,0 +1,141 @@
+#pragma once
+#include "../Config.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace casioemu
+{
+	/**
+	 * A save state being written or read. Every component describes its state
+	 * once, in a `SerializeState` that passes its fields to `Field` in a fixed
+	 * order, and the same function saves and restores it (see `Loading`).
+	 * Running out of data or hitting a section tag that doesn't match makes the
+	 * archive fail; fields are left alone from then on.
+	 */
+	class StateArchive
+	{
+		std::vector<uint8_t> *output;
+		const uint8_t *input;
+		size_t input_size, position;
+		bool failed, shares_ram;
+
+	public:
+		/**
+		 * Appends the state to `output`.
+		 */
+		StateArchive(std::vector<uint8_t> &output) : output(&output), input(nullptr), input_size(0), position(0), failed(false), shares_ram(false)
+		{
+		}
+
+		/**
+		 * Restores the state from `size` bytes at `input`.
+		 */
+		StateArchive(const uint8_t *input, size_t size) : output(nullptr), input(input), input_size(size), position(0), failed(false), shares_ram(false)
+		{
+		}
+
+		bool Loading()
+		{
+			return !output;
+		}
+
+		bool Failed()
+		{
+			return failed;
+		}
+
+		bool AtEnd()
+		{
+			return position == input_size;
+		}
+
+		void Fail()
+		{
+			failed = true;
+		}
+
+		/**
+		 * Leaves the RAM out, for states whose RAM pages are shared instead
+		 * (see `BatteryBackedRAM::ShareRAM`).
+		 */
+		void ShareRAM()
+		{
+			shares_ram = true;
+		}
+
+		bool SharesRAM()
+		{
+			return shares_ram;
+		}
+
+		void Bytes(void *bytes, size_t length)
+		{
+			if (!length)
+				return;
+			if (output)
+			{
+				output->insert(output->end(), (uint8_t *)bytes, (uint8_t *)bytes + length);
+				return;
+			}
+
+			if (failed || length > input_size - position)
+			{
+				failed = true;
+				return;
+			}
+			std::memcpy(bytes, input + position, length);
+			position += length;
+		}
+
+		template<typename value_type>
+		void Field(value_type &value)
+		{
+			static_assert(std::is_trivially_copyable<value_type>::value, "only plain data can be saved as is");
+			Bytes(&value, sizeof(value));
+		}
+
+		template<typename value_type>
+		void Field(std::vector<value_type> &values)
+		{
+			static_assert(std::is_trivially_copyable<value_type>::value, "only plain data can be saved as is");
+			uint64_t size = values.size();
+			Field(size);
+			if (Loading())
+			{
+				if (failed || size > (input_size - position) / sizeof(value_type))
+				{
+					failed = true;
+					return;
+				}
+				values.resize(size);
+			}
+			Bytes(values.data(), size * sizeof(value_type));
+		}
+
+		/**
+		 * Marks the start of a component's fields, so that a state with a
+		 * different layout fails to load instead of scrambling the machine.
+		 */
+		void Section(const std::string &tag)
+		{
+			uint8_t length = tag.size();
+			if (!Loading())
+			{
+				Field(length);
+				Bytes((void *)tag.data(), length);
+				return;
+			}
+
+			uint8_t saved_length = 0;
+			Field(saved_length);
+			std::string saved_tag(saved_length, '\0');
+			Bytes(&saved_tag[0], saved_length);
+			if (saved_tag != tag)
+				failed = true;
+		}
+	};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "../Config.hpp"
+
+#include <atomic>
+
+namespace casioemu
+{
+	/**
+	 * Hands values from one writer thread to one reader thread without either
+	 * of them waiting for the other. The writer fills `Back` and `Publish`es
+	 * it; the reader calls `Update` and reads `Front`, which is the value
+	 * published last. Values published in between are skipped.
+	 *
+	 * Each side owns one of the three slots, the third one (`middle`) is
+	 * swapped with the writer's slot on `Publish` and with the reader's slot
+	 * on `Update`. `fresh` marks a middle slot the reader hasn't taken yet.
+	 * The slot published last (`published`) only comes back to the writer
+	 * on the next `Publish`, so the writer may keep reading it until then.
+	 */
+	template<typename value_type>
+	class TripleBuffer
+	{
+		static const unsigned fresh = 4;
+
+		value_type slots[3];
+		std::atomic<unsigned> middle;
+		unsigned back, front, published;
+
+	public:
+		TripleBuffer() : middle(1), back(0), front(2), published(1)
+		{
+		}
+
+		value_type &Back()
+		{
+			return slots[back];
+		}
+
+		void Publish()
+		{
+			published = back;
+			back = middle.exchange(back | fresh) & ~fresh;
+		}
+
+		/**
+		 * The value published last, for the writer.
+		 */
+		const value_type &Published()
+		{
+			return slots[published];
+		}
+
+		/**
+		 * Takes the value published last, if it's newer than `Front`.
+		 * Returns whether it was.
+		 */
+		bool Update()
+		{
+			if (!(middle.load() & fresh))
+				return false;
+			front = middle.exchange(front) & ~fresh;
+			return true;
+		}
+
+		value_type &Front()
+		{
+			return slots[front];
+		}
+	};
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Config.hpp"
+
+#include <cstdint>
+
+namespace casioemu
+{
+	/**
+	 * Breakpoint source the CPU consults before each instruction and after each
+	 * `POP PC`. Implemented by the GUI's code viewer; every emulator has its
+	 * own (`Emulator::debugger`), or none.
+	 */
+	class Debugger
+	{
+	public:
+		virtual ~Debugger() = default;
+		/**
+		 * Returns true if the emulator should pause before the instruction at
+		 * `segment:offset` is executed.
+		 */
+		virtual bool BreakAt(uint8_t segment, uint16_t offset) = 0;
+		/**
+		 * Returns true if the emulator should pause after returning to
+		 * `segment:offset`.
+		 */
+		virtual bool BreakOnReturn(uint8_t segment, uint16_t offset) = 0;
+	};
+}
@@ -1,23 +1,72 @@
 #include "Emulator.hpp"
 
 #include "Chipset/Chipset.hpp"
+#include "Chipset/CPU.hpp"
+#include "Chipset/MMU.hpp"
 #include "Logger.hpp"
 #include "Data/EventCode.hpp"
+#include "Data/StateArchive.hpp"
+#include "Debugger.hpp"
+#include "Peripheral/BatteryBackedRAM.hpp"
+#include "Peripheral/Keyboard.hpp"
+#include "Peripheral/Screen.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <chrono>
 #include <cassert>
+#include <cstring>
+#include <iterator>
 
 namespace casioemu
 {
-	Emulator::Emulator(std::map<std::string, std::string> &_argv_map, bool _paused) : paused(_paused), argv_map(_argv_map), chipset(*new Chipset(*this))
+	struct Emulator::Snapshot
 	{
-		std::lock_guard<decltype(access_mx)> access_lock(access_mx);
+		Uint64 cycle;
+		// * Everything but the RAM.
+		std::vector<uint8_t> state;
+		BatteryBackedRAM::RAMPages ram_pages;
+	};
+
+	/**
+	 * Stops the CPU at the address of a `RunTarget` and passes everything
+	 * else on to the debugger attached to the emulator, if any.
+	 */
+	class RunTargetDebugger : public Debugger
+	{
+	public:
+		Debugger *next;
+		uint32_t address;
+		bool reached, next_broke;
+
+		RunTargetDebugger(Debugger *next, uint32_t address) : next(next), address(address), reached(false), next_broke(false)
+		{
+		}
+
+		bool BreakAt(uint8_t segment, uint16_t offset) override
+		{
+			next_broke = next && next->BreakAt(segment, offset);
+			if (((uint32_t)segment << 16 | offset) == address)
+				reached = true;
+			return reached || next_broke;
+		}
+
+		bool BreakOnReturn(uint8_t segment, uint16_t offset) override
+		{
+			return next && next->BreakOnReturn(segment, offset);
+		}
+	};
+
+	Emulator::Emulator(std::map<std::string, std::string> &_argv_map, bool _paused) : paused(_paused), tick_thread(nullptr), commands_closed(true), argv_map(_argv_map), chipset(*new Chipset(*this))
+	{
+		AccessLock access_lock(*this);
 
 		running = true;
+		headless = argv_map.find("headless") != argv_map.end();
+		debugger = nullptr;
 		model_path = argv_map["model"];
 
 		lua_state = luaL_newstate();
@@ -34,11 +83,16 @@ namespace casioemu
 		cycles_per_second = hardware_id == HW_ES_PLUS ? 128 * 1024 * 2 : hardware_id == HW_CLASSWIZ ? 1024 * 1024 * 2 : 2048 * 1024 * 2;
 		timer_interval = 20;
 
+		// * The screen publishes its first frame with the cycle count during setup.
+		cycle_count = 0;
 		cycles.Setup(cycles_per_second, timer_interval);
 		chipset.Setup();
 
 		BatteryVoltage = 1.5;
 		SolarPanelVoltage = 1.5;
+		journal_position = 0;
+		recording = replaying = emulating = rewinding = false;
+		frame_published = false;
 
 		interface_background = GetModelInfo("rsd_interface");
 		if (interface_background.dest.x != 0 || interface_background.dest.y != 0)
@@ -75,71 +129,152 @@ namespace casioemu
 			PANIC("out of range width/height parameter\n");
 		}
 
-		SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
-		window = SDL_CreateWindow(
-			std::string(GetModelInfo("model_name")).c_str(),
-			SDL_WINDOWPOS_UNDEFINED,
-			SDL_WINDOWPOS_UNDEFINED,
-			width, height,
-			SDL_WINDOW_SHOWN |
-			(SDL_WINDOW_RESIZABLE)
-		);
-		if (!window)
-			PANIC("SDL_CreateWindow failed: %s\n", SDL_GetError());
-		renderer = SDL_CreateRenderer(window, -1, 0);
-		if (!renderer)
-			PANIC("SDL_CreateRenderer failed: %s\n", SDL_GetError());
-
-		SDL_Surface *loaded_surface = IMG_Load(GetModelFilePath(GetModelInfo("interface_image_path")).c_str());
-		if (!loaded_surface)
-			PANIC("IMG_Load failed: %s\n", IMG_GetError());
-		interface_texture = SDL_CreateTextureFromSurface(renderer, loaded_surface);
-		SDL_FreeSurface(loaded_surface);
+		rewind_interval = cycles_per_second / 10;
+		// * Nobody rewinds the batch runner or a library instance by hand,
+		//   they'd only pay for the snapshots.
+		rewind_capacity = headless || argv_map.find("external_clock") != argv_map.end() ? 0 : 600;
+		try
+		{
+			auto interval_iter = argv_map.find("rewind_interval");
+			if (interval_iter != argv_map.end())
+				rewind_interval = std::max<Uint64>(std::stoull(interval_iter->second) * cycles_per_second / 1000, 1);
 
-		SetupInternals();
-		cycles.Reset();
+			auto snapshots_iter = argv_map.find("rewind_snapshots");
+			if (snapshots_iter != argv_map.end())
+				rewind_capacity = std::stoul(snapshots_iter->second);
+		}
+		catch (std::logic_error const&)
+		{
+			PANIC("invalid rewind_interval/rewind_snapshots parameter\n");
+		}
+		next_snapshot_cycle = 0;
 
-		tick_thread = new std::thread([this] {
-			auto iteration_end = std::chrono::steady_clock::now();
-			while (1)
-			{
-				{
-					std::lock_guard<decltype(access_mx)> access_lock(access_mx);
-					if (!Running())
-						break;
-					TimerCallback();
-				}
+		speed = 1;
+		run_target_slice = cycles_per_second / 100;
+		speed_sample_start = std::chrono::steady_clock::now();
+		speed_sample_cycle = 0;
+		achieved_cycles_per_second = 0;
+		try
+		{
+			auto speed_iter = argv_map.find("speed");
+			if (speed_iter != argv_map.end())
+				speed = std::max(std::stof(speed_iter->second), 0.0f);
+		}
+		catch (std::logic_error const&)
+		{
+			PANIC("invalid speed parameter\n");
+		}
 
-				iteration_end += std::chrono::milliseconds(timer_interval);
-				auto now = std::chrono::steady_clock::now();
-				if (iteration_end > now)
-					std::this_thread::sleep_until(iteration_end);
-				else // in case the computer is not fast enough or paused
-					iteration_end = now;
-			}
-		});
+		window = nullptr;
+		renderer = nullptr;
+		interface_texture = nullptr;
+		interface_surface = nullptr;
+		composition_texture = nullptr;
+		if (!headless)
+		{
+			SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
+			window = SDL_CreateWindow(
+				std::string(GetModelInfo("model_name")).c_str(),
+				SDL_WINDOWPOS_UNDEFINED,
+				SDL_WINDOWPOS_UNDEFINED,
+				width, height,
+				SDL_WINDOW_SHOWN |
+				(SDL_WINDOW_RESIZABLE)
+			);
+			if (!window)
+				PANIC("SDL_CreateWindow failed: %s\n", SDL_GetError());
+			renderer = SDL_CreateRenderer(window, -1, 0);
+			if (!renderer)
+				PANIC("SDL_CreateRenderer failed: %s\n", SDL_GetError());
+
+			SDL_Surface *loaded_surface = IMG_Load(GetModelFilePath(GetModelInfo("interface_image_path")).c_str());
+			if (!loaded_surface)
+				PANIC("IMG_Load failed: %s\n", IMG_GetError());
+			interface_texture = SDL_CreateTextureFromSurface(renderer, loaded_surface);
+			interface_surface = SDL_ConvertSurfaceFormat(loaded_surface, SDL_PIXELFORMAT_ARGB8888, 0);
+			if (!interface_surface)
+				PANIC("SDL_ConvertSurfaceFormat failed: %s\n", SDL_GetError());
+			SDL_FreeSurface(loaded_surface);
+		}
+
+		SetupInternals();
+		cycles.Reset();
 
 		RunStartupScript();
 
 		chipset.Reset();
 
+		if (argv_map.find("replay") != argv_map.end())
+			StartReplay(argv_map["replay"]);
+		else if (argv_map.find("record") != argv_map.end())
+			StartRecording();
+
 		if (argv_map.find("paused") != argv_map.end())
 			SetPaused(true);
 
 		pause_on_mem_error = argv_map.find("pause_on_mem_error") != argv_map.end();
+
+		// * Started last: from here on, only the tick thread touches the machine.
+		if (argv_map.find("external_clock") == argv_map.end())
+		{
+			commands_closed = false;
+			tick_thread = new std::thread([this] {
+				auto iteration_end = std::chrono::steady_clock::now();
+				while (1)
+				{
+					RunCommands();
+					if (!Running())
+						break;
+
+					// * Woken up early for commands otherwise.
+					if (std::chrono::steady_clock::now() >= iteration_end)
+					{
+						TimerCallback();
+
+						// * Unthrottled slices already took a timer
+						//   interval of real time each.
+						auto now = std::chrono::steady_clock::now();
+						iteration_end += std::chrono::milliseconds(timer_interval);
+						if ((speed == 0 || fast_forward) && !paused)
+							iteration_end = now;
+						else if (iteration_end < now) // in case the computer is not fast enough or paused
+							iteration_end = now;
+					}
+
+					std::unique_lock<std::mutex> wake_lock(wake_mx);
+					wake.wait_until(wake_lock, iteration_end, [this] {
+						return !commands.Empty() || !Running();
+					});
+				}
+
+				// * Commands posted from now on run on the posting thread.
+				commands_closed = true;
+				AccessLock access_lock(*this);
+				RunCommands();
+			});
+		}
 	}
 
 	Emulator::~Emulator()
 	{
-		if (tick_thread->joinable())
+		if (tick_thread && tick_thread->joinable())
 			tick_thread->join();
 		delete tick_thread;
 		
-		std::lock_guard<decltype(access_mx)> access_lock(access_mx);
+		AccessLock access_lock(*this);
 
-		SDL_DestroyTexture(interface_texture);
-		SDL_DestroyRenderer(renderer);
-		SDL_DestroyWindow(window);
+		if (recording && argv_map.find("record") != argv_map.end())
+			StopRecording(argv_map["record"]);
+
+		if (!headless)
+		{
+			SDL_DestroyTexture(interface_texture);
+			SDL_FreeSurface(interface_surface);
+			if (composition_texture)
+				SDL_DestroyTexture(composition_texture);
+			SDL_DestroyRenderer(renderer);
+			SDL_DestroyWindow(window);
+		}
 
 		luaL_unref(lua_state, LUA_REGISTRYINDEX, lua_model_ref);
 		lua_close(lua_state);
@@ -157,7 +292,7 @@ namespace casioemu
 
 	void Emulator::UIEvent(SDL_Event &event)
 	{
-		std::lock_guard<decltype(access_mx)> access_lock(access_mx);
+		AccessLock access_lock(*this);
 
 		// For mouse events, rescale the coordinates from window size to original size.
 		switch (event.type)
@@ -178,7 +313,26 @@ namespace casioemu
 			event.wheel.y *= (float) interface_background.dest.h / height;
 			break;
 		}
-		chipset.UIEvent(event);
+
+		// * Only buttons and keys change the machine, there's no point in
+		//   journaling the rest.
+		switch (event.type)
+		{
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+		{
+			InputEvent input(InputEvent::IE_UI_EVENT);
+			input.data.assign((uint8_t *)&event, (uint8_t *)&event + sizeof(event));
+			Input(input);
+			break;
+		}
+		default:
+			if (!replaying)
+				chipset.UIEvent(event);
+			break;
+		}
 	}
 
 	void Emulator::RunStartupScript()
@@ -234,6 +388,113 @@ namespace casioemu
 			return 0;
 		});
 		lua_setfield(lua_state, -2, "SetClockSpeed");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			emu->SetSpeed(luaL_checknumber(lua_state, 2));
+			return 0;
+		});
+		lua_setfield(lua_state, -2, "set_speed");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			double achieved = emu->GetAchievedCyclesPerSecond();
+			lua_pushnumber(lua_state, achieved / 1000000);
+			lua_pushnumber(lua_state, achieved / emu->GetCyclesPerSecond());
+			return 2;
+		});
+		lua_setfield(lua_state, -2, "speed");
+		lua_fast_forward_ref = LUA_REFNIL;
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			emu->CancelFastForward();
+			if (lua_isnoneornil(lua_state, 2))
+				return 0;
+			luaL_checktype(lua_state, 2, LUA_TTABLE);
+
+			RunTarget target;
+			if (lua_getfield(lua_state, 2, "cycles") != LUA_TNIL)
+				target.cycle = emu->cycle_count + std::max<lua_Integer>(luaL_checkinteger(lua_state, -1), 1);
+			lua_pop(lua_state, 1);
+			if (lua_getfield(lua_state, 2, "pc") != LUA_TNIL)
+				target.address = luaL_checkinteger(lua_state, -1) & 0xFFFFF;
+			lua_pop(lua_state, 1);
+			if (lua_getfield(lua_state, 2, "lcd") != LUA_TNIL)
+			{
+				const char *path = luaL_checkstring(lua_state, -1);
+				std::ifstream lcd_handle(path, std::ifstream::binary);
+				target.lcd.assign(std::istreambuf_iterator<char>(lcd_handle), std::istreambuf_iterator<char>());
+				int width = 0;
+				int height = 0;
+				emu->chipset.screen->GetDotMatrixSize(width, height);
+				if (lcd_handle.bad() || target.lcd.size() != (size_t)width * height)
+					return luaL_error(lua_state, "%s is not a dot matrix of this model", path);
+			}
+			lua_pop(lua_state, 1);
+			if (lua_getfield(lua_state, 2, "condition") != LUA_TNIL)
+			{
+				luaL_checktype(lua_state, -1, LUA_TFUNCTION);
+				emu->lua_fast_forward_ref = luaL_ref(lua_state, LUA_REGISTRYINDEX);
+				target.condition = [emu]() {
+					lua_geti(emu->lua_state, LUA_REGISTRYINDEX, emu->lua_fast_forward_ref);
+					if (lua_pcall(emu->lua_state, 0, 1, 0) != LUA_OK)
+					{
+						logger::Info("fast_forward condition failed: %s\n", lua_tostring(emu->lua_state, -1));
+						lua_pop(emu->lua_state, 1);
+						return true;
+					}
+					bool met = lua_toboolean(emu->lua_state, -1);
+					lua_pop(emu->lua_state, 1);
+					return met;
+				};
+			}
+			else
+				lua_pop(lua_state, 1);
+
+			emu->FastForward(target);
+			return 0;
+		});
+		lua_setfield(lua_state, -2, "fast_forward");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			lua_pushboolean(lua_state, emu->SaveStateFile(luaL_checkstring(lua_state, 2)));
+			return 1;
+		});
+		lua_setfield(lua_state, -2, "save_state");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			lua_pushboolean(lua_state, emu->LoadStateFile(luaL_checkstring(lua_state, 2)));
+			return 1;
+		});
+		lua_setfield(lua_state, -2, "load_state");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			lua_pushboolean(lua_state, emu->Rewind(luaL_checkinteger(lua_state, 2)));
+			return 1;
+		});
+		lua_setfield(lua_state, -2, "rewind");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			lua_pushinteger(lua_state, emu->cycle_count);
+			return 1;
+		});
+		lua_setfield(lua_state, -2, "cycles");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			emu->StartRecording();
+			return 0;
+		});
+		lua_setfield(lua_state, -2, "record");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			lua_pushboolean(lua_state, emu->StopRecording(luaL_checkstring(lua_state, 2)));
+			return 1;
+		});
+		lua_setfield(lua_state, -2, "stop_recording");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			lua_pushboolean(lua_state, emu->StartReplay(luaL_checkstring(lua_state, 2)));
+			return 1;
+		});
+		lua_setfield(lua_state, -2, "replay");
 		lua_model_ref = LUA_REFNIL;
 		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
 			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
@@ -272,6 +533,81 @@ namespace casioemu
 			return 0;
 		});
 		lua_setfield(lua_state, -2, "post_tick");
+		last_lua_hook_id = 0;
+		instruction_hooks = frame_hooks = 0;
+		next_hook_cycle = UINT64_MAX;
+		last_instruction_count = 0;
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			luaL_checktype(lua_state, 2, LUA_TFUNCTION);
+
+			LuaHook hook;
+			hook.kind = LuaHook::LH_INSTRUCTION;
+			hook.interval = 0;
+			hook.register_raw = nullptr;
+			hook.register_mask = hook.register_value = 0;
+			if (!lua_isnoneornil(lua_state, 3))
+			{
+				luaL_checktype(lua_state, 3, LUA_TTABLE);
+
+				if (lua_getfield(lua_state, 3, "every") == LUA_TNUMBER)
+				{
+					hook.kind = LuaHook::LH_CYCLES;
+					hook.interval = std::max<lua_Integer>(lua_tointeger(lua_state, -1), 1);
+				}
+				else if (!lua_isnil(lua_state, -1))
+				{
+					std::string every = luaL_checkstring(lua_state, -1);
+					if (every == "frame")
+						hook.kind = LuaHook::LH_FRAME;
+					else if (every != "instruction")
+						return luaL_error(lua_state, "every must be a number of cycles, 'instruction' or 'frame'");
+				}
+				lua_pop(lua_state, 1);
+
+				if (lua_getfield(lua_state, 3, "pc") == LUA_TTABLE)
+				{
+					for (lua_Integer ix = 1; lua_geti(lua_state, -1, ix) != LUA_TNIL; ++ix)
+					{
+						hook.addresses.push_back(luaL_checkinteger(lua_state, -1));
+						lua_pop(lua_state, 1);
+					}
+					lua_pop(lua_state, 1);
+				}
+				else if (!lua_isnil(lua_state, -1))
+					hook.addresses.push_back(luaL_checkinteger(lua_state, -1));
+				lua_pop(lua_state, 1);
+				std::sort(hook.addresses.begin(), hook.addresses.end());
+
+				if (lua_getfield(lua_state, 3, "register") != LUA_TNIL)
+				{
+					const char *name = luaL_checkstring(lua_state, -1);
+					if (!emu->chipset.cpu.FindRegister(name, hook.register_raw, hook.register_mask))
+						return luaL_error(lua_state, "no register called %s", name);
+					lua_getfield(lua_state, 3, "value");
+					hook.register_value = luaL_checkinteger(lua_state, -1);
+					lua_pop(lua_state, 1);
+				}
+				lua_pop(lua_state, 1);
+			}
+
+			lua_pushvalue(lua_state, 2);
+			hook.ref = luaL_ref(lua_state, LUA_REGISTRYINDEX);
+			hook.id = ++emu->last_lua_hook_id;
+			hook.last_cycle = emu->cycle_count;
+			hook.next_cycle = emu->cycle_count + hook.interval;
+			emu->lua_hooks.push_back(hook);
+			emu->ScheduleLuaHooks();
+			lua_pushinteger(lua_state, hook.id);
+			return 1;
+		});
+		lua_setfield(lua_state, -2, "hook");
+		lua_pushcfunction(lua_state, [](lua_State *lua_state) {
+			Emulator *emu = *(Emulator **)lua_topointer(lua_state, 1);
+			emu->RemoveLuaHook(luaL_checkinteger(lua_state, 2));
+			return 0;
+		});
+		lua_setfield(lua_state, -2, "unhook");
 		lua_setfield(lua_state, -2, "__index");
 		lua_pushcfunction(lua_state, [](lua_State *) {
 			return 0;
@@ -284,6 +620,547 @@ namespace casioemu
 	void Emulator::SetupInternals()
 	{
 		chipset.SetupInternals();
+
+		rom_hash = 0xCBF29CE484222325;
+		for (unsigned char byte : *chipset.rom_data)
+			rom_hash = (rom_hash ^ byte) * 0x100000001B3;
+	}
+
+	/**
+	 * Bump this whenever a `SerializeState` changes, states of other versions
+	 * are refused.
+	 */
+	static const uint32_t save_state_version = 2;
+
+	void Emulator::SerializeState(StateArchive &archive)
+	{
+		archive.Section("CasioEmu");
+		uint32_t version = save_state_version;
+		uint32_t saved_hardware_id = hardware_id;
+		uint64_t saved_rom_hash = rom_hash;
+		archive.Field(version);
+		archive.Field(saved_hardware_id);
+		archive.Field(saved_rom_hash);
+		if (version != save_state_version || saved_hardware_id != (uint32_t)hardware_id || saved_rom_hash != rom_hash)
+		{
+			archive.Fail();
+			return;
+		}
+
+		archive.Field(BatteryVoltage);
+		archive.Field(SolarPanelVoltage);
+		archive.Field(cycle_count);
+		chipset.SerializeState(archive);
+
+		if (archive.Loading())
+		{
+			for (auto &hook : lua_hooks)
+				hook.next_cycle = cycle_count + hook.interval;
+			ScheduleLuaHooks();
+		}
+	}
+
+	/**
+	 * Recounts the hooks of each kind and finds the next cycle an LH_CYCLES
+	 * hook is due at, after hooks were added or removed or time jumped.
+	 */
+	void Emulator::ScheduleLuaHooks()
+	{
+		instruction_hooks = frame_hooks = 0;
+		next_hook_cycle = UINT64_MAX;
+		for (auto &hook : lua_hooks)
+		{
+			if (hook.kind == LuaHook::LH_INSTRUCTION)
+				++instruction_hooks;
+			else if (hook.kind == LuaHook::LH_FRAME)
+				++frame_hooks;
+			else
+				next_hook_cycle = std::min(next_hook_cycle, hook.next_cycle);
+		}
+		last_instruction_count = chipset.instruction_count;
+	}
+
+	void Emulator::RemoveLuaHook(int id)
+	{
+		for (auto it = lua_hooks.begin(); it != lua_hooks.end(); ++it)
+			if (it->id == id)
+			{
+				luaL_unref(lua_state, LUA_REGISTRYINDEX, it->ref);
+				lua_hooks.erase(it);
+				ScheduleLuaHooks();
+				return;
+			}
+	}
+
+	/**
+	 * Calls the hooks of `kind` that are due and whose predicates hold, with
+	 * the cycle count, the code address and the number of cycles since the
+	 * hook was last called. Hooks may add and remove hooks, so they are
+	 * looked up by index and id after every call.
+	 */
+	void Emulator::RunLuaHooks(LuaHook::Kind kind)
+	{
+		if (rewinding)
+			return;
+		uint32_t address = (uint32_t)chipset.cpu.reg_csr.raw << 16 | chipset.cpu.reg_pc.raw;
+		for (size_t ix = 0; ix != lua_hooks.size(); ++ix)
+		{
+			LuaHook &hook = lua_hooks[ix];
+			if (hook.kind != kind)
+				continue;
+			if (kind == LuaHook::LH_CYCLES)
+			{
+				if (cycle_count < hook.next_cycle)
+					continue;
+				hook.next_cycle = cycle_count + hook.interval;
+			}
+			if (!hook.addresses.empty() && !std::binary_search(hook.addresses.begin(), hook.addresses.end(), address))
+				continue;
+			if (hook.register_raw && (*hook.register_raw & hook.register_mask) != hook.register_value)
+				continue;
+
+			int id = hook.id;
+			Uint64 elapsed = cycle_count - hook.last_cycle;
+			hook.last_cycle = cycle_count;
+			lua_geti(lua_state, LUA_REGISTRYINDEX, hook.ref);
+			lua_pushinteger(lua_state, cycle_count);
+			lua_pushinteger(lua_state, address);
+			lua_pushinteger(lua_state, elapsed);
+			if (lua_pcall(lua_state, 3, 0, 0) != LUA_OK)
+			{
+				logger::Info("hook failed: %s\n", lua_tostring(lua_state, -1));
+				lua_pop(lua_state, 1);
+				RemoveLuaHook(id);
+				logger::Info("  hook unregistered\n");
+			}
+
+			// * Step back to wherever this hook is now, if it's still there.
+			while (ix != (size_t)-1 && (ix >= lua_hooks.size() || lua_hooks[ix].id > id))
+				--ix;
+		}
+
+		if (kind == LuaHook::LH_CYCLES)
+			ScheduleLuaHooks();
+	}
+
+	void Emulator::SaveState(std::vector<uint8_t> &state)
+	{
+		AccessLock access_lock(*this);
+		StateArchive archive(state);
+		SerializeState(archive);
+	}
+
+	bool Emulator::LoadState(const std::vector<uint8_t> &state)
+	{
+		AccessLock access_lock(*this);
+
+		// * A state can turn out to be broken halfway through, so keep the
+		//   current one to go back to.
+		std::vector<uint8_t> backup;
+		StateArchive backup_archive(backup);
+		SerializeState(backup_archive);
+		Uint64 load_cycle = cycle_count;
+
+		StateArchive archive(state.data(), state.size());
+		SerializeState(archive);
+		if (!archive.Failed() && archive.AtEnd())
+		{
+			// * Only loads that worked are journaled, at the cycle they
+			//   arrived at, so that replays don't trip over broken states.
+			if (recording && !emulating)
+			{
+				InputEvent input(InputEvent::IE_LOAD_STATE);
+				input.data = state;
+				input.cycle = load_cycle;
+				journal.push_back(input);
+			}
+
+			// * The machine is somewhere else in time now.
+			snapshots.clear();
+			rewind_input.clear();
+			next_snapshot_cycle = cycle_count;
+			return true;
+		}
+
+		StateArchive restore_archive(backup.data(), backup.size());
+		SerializeState(restore_archive);
+		logger::Info("Save state is damaged or doesn't match this model\n");
+		return false;
+	}
+
+	bool Emulator::SaveStateFile(const std::string &path)
+	{
+		std::vector<uint8_t> state;
+		SaveState(state);
+
+		std::ofstream state_handle(path, std::ofstream::binary);
+		state_handle.write((char *)state.data(), state.size());
+		if (state_handle.fail())
+		{
+			logger::Info("Failed to write save state to %s\n", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool Emulator::LoadStateFile(const std::string &path)
+	{
+		std::ifstream state_handle(path, std::ifstream::binary);
+		if (state_handle.fail())
+		{
+			logger::Info("Failed to read save state from %s\n", path.c_str());
+			return false;
+		}
+		std::vector<uint8_t> state((std::istreambuf_iterator<char>(state_handle)), std::istreambuf_iterator<char>());
+		return LoadState(state);
+	}
+
+	Emulator *Emulator::Fork(std::map<std::string, std::string> &fork_argv_map)
+	{
+		AccessLock access_lock(*this);
+
+		fork_argv_map = argv_map;
+		fork_argv_map.erase("ram");
+		fork_argv_map.erase("script");
+		fork_argv_map.erase("paused");
+		fork_argv_map["rewind_snapshots"] = "0";
+		fork_argv_map["headless"] = "";
+		fork_argv_map["external_clock"] = "";
+
+		Emulator *fork = new Emulator(fork_argv_map);
+		if (!ForkInto(*fork))
+			PANIC("forked emulator doesn't match its parent\n");
+		return fork;
+	}
+
+	bool Emulator::ForkInto(Emulator &target)
+	{
+		AccessLock access_lock(*this);
+		AccessLock target_access_lock(target);
+
+		// * The header is checked before anything is restored, so a state
+		//   of another model leaves `target` untouched.
+		std::vector<uint8_t> state;
+		StateArchive archive(state);
+		archive.ShareRAM();
+		SerializeState(archive);
+
+		StateArchive target_archive(state.data(), state.size());
+		target_archive.ShareRAM();
+		target.SerializeState(target_archive);
+		if (target_archive.Failed() || !target_archive.AtEnd())
+			return false;
+
+		target.snapshots.clear();
+		target.rewind_input.clear();
+		target.next_snapshot_cycle = target.cycle_count;
+		return target.chipset.battery_backed_ram->RestoreRAM(chipset.battery_backed_ram->ShareRAM());
+	}
+
+	void Emulator::TakeSnapshot()
+	{
+		next_snapshot_cycle = cycle_count + rewind_interval;
+		if (!rewind_capacity)
+			return;
+
+		std::unique_ptr<Snapshot> snapshot;
+		if (snapshots.size() == rewind_capacity)
+		{
+			// * Reuse the oldest one, its state buffer is about the right size.
+			snapshot = std::move(snapshots.front());
+			snapshots.pop_front();
+			snapshot->state.clear();
+		}
+		else
+			snapshot.reset(new Snapshot);
+
+		snapshot->cycle = cycle_count;
+		StateArchive archive(snapshot->state);
+		archive.ShareRAM();
+		SerializeState(archive);
+		snapshot->ram_pages = chipset.battery_backed_ram->ShareRAM();
+		snapshots.push_back(std::move(snapshot));
+
+		// * Input at the oldest snapshot's cycle arrived before it was taken.
+		while (!rewind_input.empty() && rewind_input.front().cycle <= snapshots.front()->cycle)
+			rewind_input.pop_front();
+	}
+
+	void Emulator::RestoreSnapshot(Snapshot &snapshot)
+	{
+		StateArchive archive(snapshot.state.data(), snapshot.state.size());
+		archive.ShareRAM();
+		SerializeState(archive);
+		chipset.battery_backed_ram->RestoreRAM(snapshot.ram_pages);
+	}
+
+	bool Emulator::Rewind(Uint64 cycles)
+	{
+		AccessLock access_lock(*this);
+
+		if (cycles > cycle_count)
+			return false;
+		Uint64 target_cycle = cycle_count - cycles;
+		while (!snapshots.empty() && snapshots.back()->cycle > target_cycle)
+			snapshots.pop_back();
+		if (snapshots.empty())
+			return false;
+
+		RestoreSnapshot(*snapshots.back());
+		next_snapshot_cycle = cycle_count + rewind_interval;
+
+		// * Input that arrived after the snapshot is applied again at its
+		//   cycle, and kept again as it is. Input at the target cycle and
+		//   after it is history that didn't happen.
+		std::vector<InputEvent> replay;
+		while (!rewind_input.empty() && rewind_input.back().cycle > cycle_count)
+		{
+			if (rewind_input.back().cycle < target_cycle)
+				replay.push_back(std::move(rewind_input.back()));
+			rewind_input.pop_back();
+		}
+		std::reverse(replay.begin(), replay.end());
+
+		// * Breakpoints, watchpoints and Lua hooks already triggered on the
+		//   way there, so the cycles are emulated again without them. The
+		//   replayed journal events are part of `replay` too.
+		Debugger *attached_debugger = debugger;
+		bool was_paused = paused, was_replaying = replaying;
+		debugger = nullptr;
+		replaying = false;
+		rewinding = true;
+		size_t replayed = 0;
+		while (cycle_count < target_cycle && running)
+		{
+			while (replayed != replay.size() && replay[replayed].cycle <= cycle_count)
+			{
+				ApplyInput(replay[replayed]);
+				KeepForRewind(replay[replayed++]);
+			}
+			paused = false;
+			RunCycles((replayed != replay.size() ? replay[replayed].cycle : target_cycle) - cycle_count);
+		}
+		rewinding = false;
+		debugger = attached_debugger;
+		paused = was_paused;
+
+		// * Journal events at the target cycle and after it are either
+		//   dropped from the recording or replayed again. Loading a state
+		//   clears the snapshots, and the cycle count may go backwards there,
+		//   so the search stops at loads.
+		if (recording || was_replaying)
+		{
+			size_t position = recording ? journal.size() : journal_position;
+			while (position && journal[position - 1].cycle >= target_cycle && journal[position - 1].kind != InputEvent::IE_LOAD_STATE)
+				--position;
+			if (recording)
+				journal.resize(position);
+			journal_position = position;
+			replaying = journal_position != journal.size();
+		}
+		return true;
+	}
+
+	void Emulator::Input(const InputEvent &event)
+	{
+		AccessLock access_lock(*this);
+
+		if (!emulating)
+		{
+			if (replaying)
+				return;
+			if (recording)
+			{
+				journal.push_back(event);
+				journal.back().cycle = cycle_count;
+			}
+		}
+		ApplyInput(event);
+		if (!emulating)
+		{
+			InputEvent kept = event;
+			kept.cycle = cycle_count;
+			KeepForRewind(kept);
+		}
+	}
+
+	void Emulator::KeepForRewind(const InputEvent &event)
+	{
+		// * Loading a state clears the snapshots, so there is nothing to
+		//   rewind to before a load.
+		if (rewind_capacity && event.kind != InputEvent::IE_LOAD_STATE)
+			rewind_input.push_back(event);
+	}
+
+	void Emulator::ApplyInput(const InputEvent &event)
+	{
+		switch (event.kind)
+		{
+		case InputEvent::IE_UI_EVENT:
+		{
+			SDL_Event ui_event;
+			if (event.data.size() != sizeof(ui_event))
+				break;
+			std::memcpy(&ui_event, event.data.data(), sizeof(ui_event));
+			chipset.UIEvent(ui_event);
+			break;
+		}
+		case InputEvent::IE_PRESS_KEY:
+			chipset.keyboard->PressButtonByCode(event.value);
+			break;
+		case InputEvent::IE_RELEASE_KEY:
+			chipset.keyboard->ReleaseButtonByCode(event.value);
+			break;
+		case InputEvent::IE_RELEASE_ALL_KEYS:
+			chipset.keyboard->ReleaseAll();
+			break;
+		case InputEvent::IE_INJECT_KEYS:
+			chipset.keyboard->InjectKeys(event.data, event.address, event.value);
+			break;
+		case InputEvent::IE_PORT_INPUT:
+			chipset.ApplyPortInput(event.address, event.value >> 1, event.value & 1);
+			break;
+		case InputEvent::IE_REMOVE_PORT_INPUT:
+			chipset.ApplyRemovePortInput(event.address, event.value);
+			break;
+		case InputEvent::IE_BATTERY_VOLTAGE:
+		case InputEvent::IE_SOLAR_PANEL_VOLTAGE:
+		{
+			uint32_t bits = event.value;
+			float voltage;
+			std::memcpy(&voltage, &bits, sizeof(voltage));
+			(event.kind == InputEvent::IE_BATTERY_VOLTAGE ? BatteryVoltage : SolarPanelVoltage) = voltage;
+			break;
+		}
+		case InputEvent::IE_WRITE_DATA:
+			for (size_t ix = 0; ix != event.data.size(); ++ix)
+				chipset.mmu.WriteData(event.address + ix, event.data[ix], event.value);
+			break;
+		case InputEvent::IE_WRITE_REGISTER:
+			chipset.cpu.SetRegister(std::string(event.data.begin(), event.data.end()), event.value);
+			break;
+		case InputEvent::IE_LOAD_STATE:
+			LoadState(event.data);
+			break;
+		}
+	}
+
+	void Emulator::ApplyJournal()
+	{
+		while (journal_position != journal.size() && journal[journal_position].cycle <= cycle_count)
+		{
+			ApplyInput(journal[journal_position]);
+			KeepForRewind(journal[journal_position++]);
+		}
+		if (journal_position == journal.size())
+			replaying = false;
+	}
+
+	/**
+	 * Bump this whenever `InputEvent` changes.
+	 */
+	static const uint32_t journal_version = 1;
+
+	void Emulator::SerializeJournal(StateArchive &archive)
+	{
+		archive.Section("CasioEmu journal");
+		uint32_t version = journal_version;
+		archive.Field(version);
+		if (version != journal_version)
+		{
+			archive.Fail();
+			return;
+		}
+
+		archive.Field(journal_state);
+		uint64_t event_count = journal.size();
+		archive.Field(event_count);
+		if (archive.Loading())
+			journal.clear();
+		// * Events are read one by one, so that a damaged count fails
+		//   when the data runs out.
+		for (uint64_t ix = 0; ix != event_count && !archive.Failed(); ++ix)
+		{
+			if (archive.Loading())
+				journal.emplace_back();
+			InputEvent &event = journal[ix];
+			archive.Field(event.cycle);
+			archive.Field(event.kind);
+			archive.Field(event.address);
+			archive.Field(event.value);
+			archive.Field(event.data);
+		}
+	}
+
+	void Emulator::StartRecording()
+	{
+		AccessLock access_lock(*this);
+
+		journal.clear();
+		journal_state.clear();
+		SaveState(journal_state);
+		journal_position = 0;
+		recording = true;
+		replaying = false;
+		// * Rewinding to before the journal starts would leave it behind.
+		snapshots.clear();
+		rewind_input.clear();
+		next_snapshot_cycle = cycle_count;
+	}
+
+	bool Emulator::StopRecording(const std::string &path)
+	{
+		AccessLock access_lock(*this);
+
+		if (!recording)
+			return false;
+		recording = false;
+
+		std::vector<uint8_t> journal_data;
+		StateArchive archive(journal_data);
+		SerializeJournal(archive);
+
+		std::ofstream journal_handle(path, std::ofstream::binary);
+		journal_handle.write((char *)journal_data.data(), journal_data.size());
+		if (journal_handle.fail())
+		{
+			logger::Info("Failed to write input journal to %s\n", path.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool Emulator::StartReplay(const std::string &path)
+	{
+		AccessLock access_lock(*this);
+
+		std::ifstream journal_handle(path, std::ifstream::binary);
+		if (journal_handle.fail())
+		{
+			logger::Info("Failed to read input journal from %s\n", path.c_str());
+			return false;
+		}
+		std::vector<uint8_t> journal_data((std::istreambuf_iterator<char>(journal_handle)), std::istreambuf_iterator<char>());
+
+		recording = false;
+		replaying = false;
+		StateArchive archive(journal_data.data(), journal_data.size());
+		SerializeJournal(archive);
+		if (archive.Failed() || !archive.AtEnd() || !LoadState(journal_state))
+		{
+			logger::Info("Input journal %s is damaged or doesn't match this model\n", path.c_str());
+			journal.clear();
+			return false;
+		}
+
+		journal_position = 0;
+		replaying = !journal.empty();
+		return true;
+	}
+
+	bool Emulator::Replaying()
+	{
+		return replaying;
 	}
 
 	void Emulator::LoadModelDefition()
@@ -303,17 +1180,61 @@ namespace casioemu
 		return model_path + "/" + relative_path;
 	}
 
-	void Emulator::TimerCallback()
+	void Emulator::Post(std::function<void()> command)
+	{
+		commands.Push(std::move(command));
+		if (commands_closed)
+		{
+			AccessLock access_lock(*this);
+			RunCommands();
+			return;
+		}
+
+		WakeTickThread();
+	}
+
+	void Emulator::WakeTickThread()
 	{
-		std::lock_guard<decltype(access_mx)> access_lock(access_mx);
+		// * Taking `wake_mx` makes sure the tick thread is either waiting
+		//   already or yet to check what it waits for.
+		{
+			std::lock_guard<std::mutex> wake_lock(wake_mx);
+		}
+		wake.notify_one();
+	}
 
-		Uint64 cycles_to_emulate = cycles.GetDelta();
-		for (Uint64 ix = 0; ix != cycles_to_emulate; ++ix)
-			if (!paused)
-				Tick();
+	/**
+	 * Runs the commands posted so far. Called on the tick thread, or with
+	 * `access_mx` held once there is none, which makes this the only thread
+	 * popping from `commands`.
+	 */
+	void Emulator::RunCommands()
+	{
+		std::function<void()> command;
+		while (commands.Pop(command))
+			command();
+	}
 
-		if (chipset.GetRequireFrame())
+	void Emulator::TimerCallback()
+	{
+		if (speed == 0 || fast_forward)
+			RunUnthrottled();
+		else
+			RunCycles((Uint64)(cycles.GetDelta() * speed));
+		MeasureSpeed();
+		if (frame_hooks)
+			RunLuaHooks(LuaHook::LH_FRAME);
+
+		// * The renderer only draws what's published here, it never waits for
+		//   the machine. Frame hooks may have drawn too.
+		if (chipset.screen->PublishFrame())
+			frame_published = true;
+		bool require_frame = chipset.GetRequireFrame() || frame_published;
+		frame_published = false;
+		if (!headless && require_frame)
 		{
+			chipset.PublishFrame();
+
 			SDL_Event event;
 			SDL_zero(event);
 			event.type = SDL_USEREVENT;
@@ -322,40 +1243,227 @@ namespace casioemu
 		}
 	}
 
+	/**
+	 * Emulates slices of `run_target_slice` cycles for one timer interval of
+	 * real time, and finishes a `FastForward` once its target is met.
+	 */
+	void Emulator::RunUnthrottled()
+	{
+		auto slice_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timer_interval);
+		do
+		{
+			if (!fast_forward)
+			{
+				RunCycles(run_target_slice);
+				continue;
+			}
+
+			if (RunSlice(*fast_forward))
+			{
+				logger::Info("fast forward target reached at cycle %llu\n", (unsigned long long)cycle_count);
+				EndFastForward();
+				SetPaused(true);
+			}
+		} while (running && !paused && std::chrono::steady_clock::now() < slice_end);
+	}
+
+	/**
+	 * Emulates up to `run_target_slice` cycles towards `target` and returns
+	 * whether it has been met.
+	 */
+	bool Emulator::RunSlice(const RunTarget &target)
+	{
+		Uint64 slice = run_target_slice;
+		if (target.cycle)
+		{
+			if (cycle_count >= target.cycle)
+				return true;
+			slice = std::min(slice, target.cycle - cycle_count);
+		}
+
+		RunTargetDebugger target_debugger(debugger, target.address);
+		if (target.address >= 0)
+			debugger = &target_debugger;
+		RunCycles(slice);
+		debugger = target_debugger.next;
+
+		if (target_debugger.reached)
+		{
+			// * The pause was ours, unless a breakpoint hit at the same time.
+			if (!target_debugger.next_broke)
+				SetPaused(false);
+			return true;
+		}
+		if (target.cycle && cycle_count >= target.cycle)
+			return true;
+		if (!target.lcd.empty())
+		{
+			std::vector<uint8_t> dots(target.lcd.size());
+			chipset.screen->ReadDotMatrix(chipset.screen->PublishedFrame(), dots.data());
+			if (dots == target.lcd)
+				return true;
+		}
+		return target.condition && target.condition();
+	}
+
+	bool Emulator::RunUntil(const RunTarget &target)
+	{
+		while (1)
+		{
+			AccessLock access_lock(*this);
+			if (!running || paused)
+				return false;
+			bool met = RunSlice(target);
+			MeasureSpeed();
+			if (met)
+				return true;
+		}
+	}
+
+	void Emulator::FastForward(const RunTarget &target)
+	{
+		AccessLock access_lock(*this);
+
+		fast_forward.reset(new RunTarget(target));
+	}
+
+	void Emulator::CancelFastForward()
+	{
+		AccessLock access_lock(*this);
+
+		EndFastForward();
+	}
+
+	void Emulator::EndFastForward()
+	{
+		fast_forward.reset();
+		luaL_unref(lua_state, LUA_REGISTRYINDEX, lua_fast_forward_ref);
+		lua_fast_forward_ref = LUA_REFNIL;
+	}
+
+	void Emulator::MeasureSpeed()
+	{
+		auto now = std::chrono::steady_clock::now();
+		// * Rewinding and loading states move the cycle count backwards.
+		if (cycle_count < speed_sample_cycle)
+		{
+			speed_sample_start = now;
+			speed_sample_cycle = cycle_count;
+			return;
+		}
+
+		std::chrono::duration<double> elapsed = now - speed_sample_start;
+		if (elapsed.count() < 1)
+			return;
+		achieved_cycles_per_second = (cycle_count - speed_sample_cycle) / elapsed.count();
+		speed_sample_start = now;
+		speed_sample_cycle = cycle_count;
+	}
+
+	void Emulator::SetSpeed(float _speed)
+	{
+		AccessLock access_lock(*this);
+
+		speed = std::max(_speed, 0.0f);
+	}
+
+	float Emulator::GetSpeed()
+	{
+		return speed;
+	}
+
+	double Emulator::GetAchievedCyclesPerSecond()
+	{
+		AccessLock access_lock(*this);
+
+		return achieved_cycles_per_second;
+	}
+
+	Uint64 Emulator::RunCycles(Uint64 cycles_to_emulate)
+	{
+		AccessLock access_lock(*this);
+
+		bool was_emulating = emulating;
+		emulating = true;
+
+		Uint64 ix = 0;
+		while (ix < cycles_to_emulate && !paused)
+		{
+			if (replaying)
+				ApplyJournal();
+			if (cycle_count >= next_snapshot_cycle)
+				TakeSnapshot();
+
+			Uint64 max_skip = std::min({cycles_to_emulate - ix, next_snapshot_cycle - cycle_count, next_hook_cycle - cycle_count});
+			if (replaying)
+				max_skip = std::min(max_skip, journal[journal_position].cycle - cycle_count);
+
+			// * Tick hooks expect to see every cycle, so nothing is skipped
+			//   while any of them is set.
+			if (lua_pre_tick_ref == LUA_REFNIL && lua_post_tick_ref == LUA_REFNIL)
+			{
+				size_t skipped = chipset.SkipIdleCycles(max_skip);
+				if (skipped)
+				{
+					ix += skipped;
+					cycle_count += skipped;
+					if (cycle_count >= next_hook_cycle)
+						RunLuaHooks(LuaHook::LH_CYCLES);
+					continue;
+				}
+			}
+
+			Tick();
+			++ix;
+		}
+
+		// * Readers of the LCD only see published frames, emulators with
+		//   `external_clock` included.
+		if (chipset.screen->PublishFrame())
+			frame_published = true;
+		emulating = was_emulating;
+		return ix;
+	}
+
 	void Emulator::Repaint()
 	{
+		if (headless)
+			return;
 		SDL_RenderPresent(renderer);
 	}
 
 	void Emulator::Frame()
 	{
-		std::lock_guard<decltype(access_mx)> access_lock(access_mx);
+		if (headless)
+			return;
 
-		// create texture `tx` with the same format as `interface_texture`
-		Uint32 format;
-		SDL_QueryTexture(interface_texture, &format, nullptr, nullptr, nullptr);
-		SDL_Texture* tx = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_TARGET, interface_background.dest.w, interface_background.dest.h);
+		// create `composition_texture` with the same format as `interface_texture`
+		if (!composition_texture)
+		{
+			Uint32 format;
+			SDL_QueryTexture(interface_texture, &format, nullptr, nullptr, nullptr);
+			composition_texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_TARGET, interface_background.dest.w, interface_background.dest.h);
+		}
 
-		// render on `tx`
-		SDL_SetRenderTarget(renderer, tx);
+		// render on `composition_texture`
+		SDL_SetRenderTarget(renderer, composition_texture);
 		SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 		SDL_RenderClear(renderer);
 		SDL_SetTextureColorMod(interface_texture, 255, 255, 255);
 		SDL_SetTextureAlphaMod(interface_texture, 255);
 		SDL_RenderCopy(renderer, interface_texture, &interface_background.src, nullptr);
+		chipset.screen->Frame();
 		chipset.Frame();
 
-		// resize and copy `tx` to screen
+		// resize and copy `composition_texture` to screen
 		SDL_SetRenderTarget(renderer, nullptr);
 		SDL_Rect dest {0, 0, width, height};
-		SDL_RenderCopy(renderer, tx, nullptr, &dest);
-		SDL_DestroyTexture(tx);
+		SDL_RenderCopy(renderer, composition_texture, nullptr, &dest);
 		Repaint();
 	}
 
 	void Emulator::WindowResize(int _width, int _height)
 	{
-		std::lock_guard<decltype(access_mx)> access_lock(access_mx);
 		width = _width;
 		height = _height;
 		Frame();
@@ -363,7 +1471,7 @@ namespace casioemu
 
 	void Emulator::Tick()
 	{
-		if (lua_pre_tick_ref != LUA_REFNIL)
+		if (lua_pre_tick_ref != LUA_REFNIL && !rewinding)
 		{
 			lua_geti(lua_state, LUA_REGISTRYINDEX, lua_pre_tick_ref);
 			if (lua_pcall(lua_state, 0, 0, 0) != LUA_OK)
@@ -377,8 +1485,17 @@ namespace casioemu
 		}
 
 		chipset.Tick();
+		++cycle_count;
+
+		if (instruction_hooks && chipset.instruction_count != last_instruction_count)
+		{
+			last_instruction_count = chipset.instruction_count;
+			RunLuaHooks(LuaHook::LH_INSTRUCTION);
+		}
+		if (cycle_count >= next_hook_cycle)
+			RunLuaHooks(LuaHook::LH_CYCLES);
 
-		if (lua_post_tick_ref != LUA_REFNIL)
+		if (lua_post_tick_ref != LUA_REFNIL && !rewinding)
 		{
 			lua_geti(lua_state, LUA_REGISTRYINDEX, lua_post_tick_ref);
 			if (lua_pcall(lua_state, 0, 0, 0) != LUA_OK)
@@ -404,14 +1521,14 @@ namespace casioemu
 
 	void Emulator::Shutdown()
 	{
-		std::lock_guard<decltype(access_mx)> access_lock(access_mx);
-
 		running = false;
+		if (!commands_closed)
+			WakeTickThread();
 	}
 
 	void Emulator::ExecuteCommand(std::string command)
 	{
-		std::lock_guard<decltype(access_mx)> access_lock(access_mx);
+		AccessLock access_lock(*this);
 
 		lua_State *thread = lua_newthread(lua_state);
 
@@ -478,6 +1595,11 @@ namespace casioemu
 		return interface_texture;
 	}
 
+	SDL_Surface *Emulator::GetInterfaceSurface()
+	{
+		return interface_surface;
+	}
+
 	unsigned int Emulator::GetCyclesPerSecond()
 	{
 		return cycles.cycles_per_second;
@@ -487,6 +1609,18 @@ namespace casioemu
 		cycles.Setup((unsigned int)(cycles_per_second * speed), timer_interval);
 	}
 
+	Emulator::AccessLock::AccessLock(Emulator &emulator) : mutex(emulator.commands_closed ? &emulator.access_mx : nullptr)
+	{
+		if (mutex)
+			mutex->lock();
+	}
+
+	Emulator::AccessLock::~AccessLock()
+	{
+		if (mutex)
+			mutex->unlock();
+	}
+
 	FairRecursiveMutex::FairRecursiveMutex() : holding{}, recursive_count{}
 	{
 	}
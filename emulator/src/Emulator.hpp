@@ -8,9 +8,17 @@
 #include <lua.hpp>
 #include <mutex>
 #include <thread>
+#include <chrono>
+#include <functional>
 #include <condition_variable>
+#include <future>
+#include <atomic>
 #include <queue>
+#include <deque>
+#include <memory>
+#include <vector>
 
+#include "Data/CommandQueue.hpp"
 #include "Data/HardwareId.hpp"
 #include "Data/ModelInfo.hpp"
 #include "Data/SpriteInfo.hpp"
@@ -20,6 +28,8 @@ namespace casioemu
 	class Chipset;
 	class CPU;
 	class MMU;
+	class Debugger;
+	class StateArchive;
 
 	/**
 	 * A mutex that ensures that a thread cannot get the mutex right after it's released if there are another waiting thread.
@@ -40,17 +50,95 @@ namespace casioemu
 
 	class Emulator
 	{
-		
+	public:
+		/**
+		 * Something from outside the machine that changes it. All external
+		 * input goes through `Input`, so that it can be journaled with the
+		 * cycle it arrived at and replayed exactly (see `StartRecording`).
+		 */
+		struct InputEvent
+		{
+			enum Kind : uint8_t
+			{
+				IE_UI_EVENT,            // * `data` holds the SDL_Event.
+				IE_PRESS_KEY,           // * `value` is the key code.
+				IE_RELEASE_KEY,         // * `value` is the key code.
+				IE_RELEASE_ALL_KEYS,
+				IE_INJECT_KEYS,         // * `data` is the sequence, `address` and `value` the press and delay cycles.
+				IE_PORT_INPUT,          // * `address` is the port, `value` the pin shifted left by 1, ORed with the level.
+				IE_REMOVE_PORT_INPUT,   // * `address` is the port, `value` the pin.
+				IE_BATTERY_VOLTAGE,     // * `value` holds the bits of the float.
+				IE_SOLAR_PANEL_VOLTAGE, // * `value` holds the bits of the float.
+				IE_WRITE_DATA,          // * `data` is written from `address` on, triggering watches if `value` is set.
+				IE_WRITE_REGISTER,      // * `data` is the name of the register, `value` the value.
+				IE_LOAD_STATE           // * `data` is a state saved by `SaveState`.
+			} kind;
+			uint32_t address;
+			uint64_t value;
+			std::vector<uint8_t> data;
+			Uint64 cycle;
+
+			InputEvent(Kind kind = IE_RELEASE_ALL_KEYS, uint32_t address = 0, uint64_t value = 0) : kind(kind), address(address), value(value), cycle(0)
+			{
+			}
+		};
+
+		/**
+		 * Where `RunUntil` and `FastForward` stop: at the first of the parts
+		 * that are set. The cycle and the address are exact, the dot matrix
+		 * and the condition are checked every `run_target_slice` cycles.
+		 */
+		struct RunTarget
+		{
+			Uint64 cycle;                    // * Value of `cycle_count` to stop at, 0 for none.
+			int32_t address;                 // * Code address (CSR << 16 | PC) to stop before, -1 for none.
+			std::vector<uint8_t> lcd;        // * Dot matrix (see `ScreenBase::ReadDotMatrix`) to stop at, empty for none.
+			std::function<bool()> condition; // * Stops once it returns true, empty for none.
+
+			RunTarget() : cycle(0), address(-1)
+			{
+			}
+		};
+
+	private:
 		SDL_Renderer *renderer;
 		SDL_Texture *interface_texture;
+		/**
+		 * The interface image in SDL_PIXELFORMAT_ARGB8888, for peripherals
+		 * that rasterize sprites on the CPU.
+		 */
+		SDL_Surface *interface_surface;
+		/**
+		 * Render target the interface is composed on before it's scaled to
+		 * the window. Kept across frames.
+		 */
+		SDL_Texture *composition_texture;
 		unsigned int cycles_per_second;
 		unsigned int timer_interval;
-		bool running, paused;
+		// * Read by any thread, see `Running` and `Shutdown`.
+		std::atomic<bool> running;
+		bool paused;
 		unsigned int last_frame_tick_count;
 		std::string model_path;
 		bool pause_on_mem_error;
 
+		/**
+		 * The tick thread owns the machine: it's the only thread that touches
+		 * it, without taking `access_mx`, and other threads hand it work
+		 * through `commands` (see `Post`) and read results back through
+		 * `Submit` or published frames. It sleeps on `wake` between timer
+		 * callbacks, so that commands don't wait for the next one.
+		 * `commands_closed` is set while there is no tick thread (before it's
+		 * started, with `external_clock` and once it has stopped); `Post`
+		 * runs commands itself then, with `access_mx` held.
+		 */
 		std::thread *tick_thread;
+		CommandQueue commands;
+		std::atomic<bool> commands_closed;
+		std::mutex wake_mx;
+		std::condition_variable wake;
+		void RunCommands();
+		void WakeTickThread();
 
 		SpriteInfo interface_background;
 		int width, height;
@@ -64,16 +152,147 @@ namespace casioemu
 		void SetupInternals();
 		void RunStartupScript();
 
+		/**
+		 * FNV-1a hash of the ROM, so that states are only loaded into
+		 * emulators running the same code.
+		 */
+		uint64_t rom_hash;
+		void SerializeState(StateArchive &archive);
+
+		/**
+		 * Rewind buffer. A snapshot of the machine is taken every
+		 * `rewind_interval` cycles and the last `rewind_capacity` ones are
+		 * kept. Snapshots share the RAM pages of the machine, which are
+		 * copied when written to (see `BatteryBackedRAM::ShareRAM`), so each
+		 * one only costs the pages written since the one before and the few
+		 * kilobytes of the rest of the state.
+		 */
+		struct Snapshot;
+		std::deque<std::unique_ptr<Snapshot>> snapshots;
+		Uint64 rewind_interval, next_snapshot_cycle;
+		size_t rewind_capacity;
+		void TakeSnapshot();
+		void RestoreSnapshot(Snapshot &snapshot);
+		/**
+		 * External input since the oldest snapshot, journaled or not, which
+		 * `Rewind` applies again on the way to its target. `rewinding` is set
+		 * meanwhile, so that watches and Lua hooks don't fire a second time.
+		 */
+		std::deque<InputEvent> rewind_input;
+		bool rewinding;
+		void KeepForRewind(const InputEvent &event);
+
+		/**
+		 * Input journal, see `StartRecording`. While replaying, the events
+		 * from `journal_position` on are applied when their cycle comes.
+		 * `emulating` is set while cycles are emulated: input from Lua hooks
+		 * and watch callbacks is part of the run rather than external input,
+		 * so it's applied without being journaled.
+		 */
+		std::vector<InputEvent> journal;
+		std::vector<uint8_t> journal_state;
+		size_t journal_position;
+		bool recording, replaying, emulating;
+		void ApplyInput(const InputEvent &event);
+		void ApplyJournal();
+		void SerializeJournal(StateArchive &archive);
+
+		/**
+		 * Speed governor, see `SetSpeed`. While `fast_forward` is set, the
+		 * timer emulates at full speed whatever `speed` is, until the target
+		 * is met. The achieved speed is measured over about a second of real
+		 * time, from `speed_sample_start` on.
+		 */
+		float speed;
+		std::unique_ptr<RunTarget> fast_forward;
+		int lua_fast_forward_ref;
+		Uint64 run_target_slice;
+		std::chrono::steady_clock::time_point speed_sample_start;
+		Uint64 speed_sample_cycle;
+		double achieved_cycles_per_second;
+		bool RunSlice(const RunTarget &target);
+		void RunUnthrottled();
+		void EndFastForward();
+		void MeasureSpeed();
+
+		/**
+		 * Lua hooks that run less often than every cycle (see `emu:hook`).
+		 * Until they fire they only cost a native check, and unlike tick
+		 * hooks they don't keep idle cycles from being skipped.
+		 * `next_hook_cycle` is the first `next_cycle` of the LH_CYCLES hooks.
+		 */
+		struct LuaHook
+		{
+			enum Kind
+			{
+				LH_INSTRUCTION,
+				LH_CYCLES,
+				LH_FRAME
+			} kind;
+			int id, ref;
+			Uint64 interval, next_cycle, last_cycle;
+			// * Only fires at these code addresses (CSR << 16 | PC), if any.
+			std::vector<uint32_t> addresses;
+			// * Only fires while this register equals `register_value`, if set.
+			const uint16_t *register_raw;
+			uint16_t register_mask, register_value;
+		};
+		std::vector<LuaHook> lua_hooks;
+		int last_lua_hook_id;
+		size_t instruction_hooks, frame_hooks;
+		Uint64 next_hook_cycle, last_instruction_count;
+		void RunLuaHooks(LuaHook::Kind kind);
+		void ScheduleLuaHooks();
+		void RemoveLuaHook(int id);
+
+		/**
+		 * Set when `RunCycles` publishes an LCD frame, until the timer asks
+		 * the renderer to draw it.
+		 */
+		bool frame_published;
+
 	public:
 		SDL_Window *window;
 		Emulator(std::map<std::string, std::string> &argv_map, bool paused = false);
 		~Emulator();
 
+		/**
+		 * Only serializes callers of emulators without a tick thread
+		 * (`external_clock`, the library) and of stopped ones. Take it through
+		 * `AccessLock`.
+		 */
 		FairRecursiveMutex access_mx;
+		/**
+		 * Holds `access_mx` while it exists, unless the tick thread owns the
+		 * machine: then everything runs on that thread and there's nothing to
+		 * lock against.
+		 */
+		class AccessLock
+		{
+			FairRecursiveMutex *mutex;
+
+		public:
+			AccessLock(Emulator &emulator);
+			~AccessLock();
+			AccessLock(const AccessLock &) = delete;
+			AccessLock &operator=(const AccessLock &) = delete;
+		};
 		lua_State *lua_state;
 		int lua_model_ref, lua_pre_tick_ref, lua_post_tick_ref;
 		HardwareId hardware_id;
 		std::map<std::string, std::string> &argv_map;
+		/**
+		 * Set by the `headless` argument. No window, renderer or textures are
+		 * created; the LCD only exists as the screen buffers in memory and
+		 * input comes from scripts.
+		 */
+		bool headless;
+		/**
+		 * Breakpoints of the debugger attached to this emulator, nullptr if
+		 * there is none. Change it on the thread that owns the machine (see
+		 * `Post`).
+		 */
+		Debugger *debugger;
 
 	private:
 		/**
@@ -105,18 +324,144 @@ namespace casioemu
 		Chipset &chipset;
 
 		float BatteryVoltage, SolarPanelVoltage;
+		/**
+		 * Number of cycles emulated since the emulator was started, part of
+		 * the machine state.
+		 */
+		Uint64 cycle_count;
 
 		bool Running();
 		void HandleMemoryError();
+		/**
+		 * Stops the emulator. Unlike everything else, this and `Running` can
+		 * be called from any thread.
+		 */
 		void Shutdown();
 		void Tick();
+		/**
+		 * Emulates up to `cycles` cycles at full speed and returns how many
+		 * were emulated, which is less if the emulator is paused on the way.
+		 * This is how emulators with `external_clock` are driven.
+		 */
+		Uint64 RunCycles(Uint64 cycles);
+		/**
+		 * Appends the complete machine state (CPU, memory, SFRs, clocks,
+		 * pending interrupts) to `state`. Debugger state such as breakpoints,
+		 * watchpoints and Lua hooks is not part of it.
+		 */
+		void SaveState(std::vector<uint8_t> &state);
+		/**
+		 * Restores a state saved by `SaveState`. Returns false and leaves the
+		 * machine alone if the state is damaged, was saved by another version
+		 * of the format or by an emulator running a different ROM.
+		 */
+		bool LoadState(const std::vector<uint8_t> &state);
+		bool SaveStateFile(const std::string &path);
+		bool LoadStateFile(const std::string &path);
+		/**
+		 * Creates a headless emulator with `external_clock` in the state of
+		 * this one, for trying several inputs from the same state. The ROM is
+		 * shared and RAM pages are shared until either emulator writes to
+		 * them. `fork_argv_map` is filled with the arguments of the new
+		 * emulator (those of this one, without `ram` and `script` and with no
+		 * rewind buffer) and must outlive it.
+		 */
+		Emulator *Fork(std::map<std::string, std::string> &fork_argv_map);
+		/**
+		 * Puts `target`, an emulator of the same model, in the state of this
+		 * one, like `Fork` but without constructing a new emulator, which
+		 * makes it cheap enough to be done once per attempt. Returns false if
+		 * `target` runs another ROM, in which case it's left alone.
+		 */
+		bool ForkInto(Emulator &target);
+		/**
+		 * Puts the machine back in the state it was in `cycles` cycles ago:
+		 * restores the last snapshot before that and emulates the cycles
+		 * after it again, with the debugger detached. Returns false if the
+		 * rewind buffer doesn't go back that far.
+		 */
+		bool Rewind(Uint64 cycles);
+		/**
+		 * Applies external input to the machine, and journals it if
+		 * recording. Input is ignored while a journal is replayed.
+		 */
+		void Input(const InputEvent &event);
+		/**
+		 * Starts journaling external input, from the current state on. The
+		 * journal holds that state and every event with the cycle it arrived
+		 * at, so it can be replayed exactly at any speed.
+		 */
+		void StartRecording();
+		/**
+		 * Stops journaling and writes the journal to `path`.
+		 */
+		bool StopRecording(const std::string &path);
+		/**
+		 * Loads the state at the start of a journal and applies its events at
+		 * the cycles they were recorded at while the emulator runs.
+		 */
+		bool StartReplay(const std::string &path);
+		/**
+		 * Whether a journal is being replayed and has events left.
+		 */
+		bool Replaying();
+		/**
+		 * Emulates at full speed, in slices with `access_mx` released in
+		 * between (for other callers of the library), until `target` is met or the emulator is paused or shut
+		 * down. Returns whether the target was met; the emulator is left
+		 * running then. For emulators with `external_clock`.
+		 */
+		bool RunUntil(const RunTarget &target);
+		/**
+		 * Has the timer emulate at full speed until `target` is met, then
+		 * pauses the emulator and goes back to the speed set by `SetSpeed`.
+		 */
+		void FastForward(const RunTarget &target);
+		void CancelFastForward();
+		/**
+		 * Emulation speed relative to real time: 1 is real time, N is N times
+		 * real time and 0 is as fast as the host allows, in slices of
+		 * `timer_interval` ms of real time.
+		 */
+		void SetSpeed(float speed);
+		float GetSpeed();
+		/**
+		 * Emulated cycles per second of real time, measured over about the
+		 * last second.
+		 */
+		double GetAchievedCyclesPerSecond();
 		/**
 		 * Called when SDL_WINDOWEVENT_EXPOSED event is received. Does not re-frame.
 		 */
 		void Repaint();
+		/**
+		 * Draws the window on the renderer's thread, from what the screen and
+		 * the other peripherals published last (see `Chipset::PublishFrame`).
+		 * Never waits for the machine.
+		 */
 		void Frame();
 		void WindowResize(int width, int height);
 		void ExecuteCommand(std::string command);
+		/**
+		 * Has the thread that owns the machine run `command` between two
+		 * timer callbacks, and returns at once. Commands run in the order
+		 * they were posted by each thread. Emulators with `external_clock`
+		 * run it right away, on the calling thread.
+		 */
+		void Post(std::function<void()> command);
+		/**
+		 * Like `Post`, with the result of `command` delivered through a future.
+		 */
+		template<typename command_type>
+		auto Submit(command_type command) -> std::future<decltype(command())>
+		{
+			auto task = std::make_shared<std::packaged_task<decltype(command())()>>(std::move(command));
+			auto result = task->get_future();
+			Post([task]() {
+				(*task)();
+			});
+			return result;
+		}
 		unsigned int GetCyclesPerSecond();
 		void SetClockSpeed(float speed);
 		bool GetPaused();
@@ -124,6 +469,7 @@ namespace casioemu
 		void UIEvent(SDL_Event &event);
 		SDL_Renderer *GetRenderer();
 		SDL_Texture *GetInterfaceTexture();
+		SDL_Surface *GetInterfaceSurface();
 		ModelInfo GetModelInfo(std::string key);
 		std::string GetModelFilePath(std::string relative_path);
 
@@ -6,6 +6,7 @@
 #include "../Logger.hpp"
 #include "imgui/imgui.h"
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
@@ -15,8 +16,7 @@
 #include <ostream>
 #include <string>
 #include <thread>
-casioemu::Emulator *m_emu = nullptr;
-CodeViewer::CodeViewer(std::string path) {
+CodeViewer::CodeViewer(casioemu::Emulator &emulator, std::string path) : emulator(emulator) {
     src_path = path;
     std::thread t1([this]() {
         std::ifstream f(src_path, std::ios::in);
@@ -83,8 +83,8 @@ bool CodeViewer::TryTrigBP(uint8_t seg, uint16_t offset, bool bp_mode) {
             CodeElem e = codes[it->first];
             if (e.segment == seg && e.offset == offset) {
                 break_points[it->first] = 2;
-                cur_col = it->first;
-                need_roll = true;
+                hit_line = it->first;
+                ++hit_count;
                 return true;
             }
         }
@@ -93,13 +93,23 @@ bool CodeViewer::TryTrigBP(uint8_t seg, uint16_t offset, bool bp_mode) {
         int idx = 0;
         LookUp(seg, offset, &idx);
         break_points[idx] = 2;
-        cur_col = idx;
-        need_roll = true;
+        hit_line = idx;
+        ++hit_count;
         return true;
     }
     return false;
 }
 
+bool CodeViewer::BreakAt(uint8_t segment, uint16_t offset) {
+    if ((debug_flags & DEBUG_BREAKPOINT) && TryTrigBP(segment, offset))
+        return true;
+    return (debug_flags & DEBUG_STEP) && TryTrigBP(segment, offset, false);
+}
+
+bool CodeViewer::BreakOnReturn(uint8_t segment, uint16_t offset) {
+    return (debug_flags & DEBUG_RET_TRACE) && TryTrigBP(segment, offset, false);
+}
+
 void CodeViewer::DrawContent() {
     ImGuiListClipper c;
     c.Begin(max_row, ImGui::GetTextLineHeight());
@@ -108,25 +118,31 @@ void CodeViewer::DrawContent() {
     while (c.Step()) {
         for (int line_i = c.DisplayStart; line_i < c.DisplayEnd; line_i++) {
             CodeElem e = codes[line_i];
-            auto it = break_points.find(line_i);
-            if (it == break_points.end()) {
+            auto it = view.break_points.find(line_i);
+            if (it == view.break_points.end()) {
                 ImGui::Text("[ o ]");
                 if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(0)) {
-                    break_points[line_i] = 1;
+                    emulator.Post([this, line_i] {
+                        break_points[line_i] = 1;
+                    });
                 }
             } else {
                 if (it->second == 1) {
                     ImGui::TextColored(ImVec4(1.0, 0.0, 0.0, 1.0), "[ x ]");
                     if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(0)) {
-                        break_points.erase(line_i);
+                        emulator.Post([this, line_i] {
+                            break_points.erase(line_i);
+                        });
                     }
                 } else {
                     ImGui::TextColored(ImVec4(0.0, 1.0, 0.0, 1.0), "[ > ]");
                     // the break point is triggered!
                     ImGui::SameLine();
                     if (ImGui::Button("Continue?")) {
-                        break_points.erase(line_i);
-                        m_emu->SetPaused(false);
+                        emulator.Post([this, line_i] {
+                            break_points.erase(line_i);
+                            emulator.SetPaused(false);
+                        });
                     }
                 }
             }
@@ -173,17 +189,35 @@ void CodeViewer::DrawContent() {
     }
 }
 
-void CodeViewer::DrawMonitor() {
-    if (m_emu != nullptr) {
-        casioemu::Chipset &chipset = m_emu->chipset;
-        std::string s = chipset.cpu.GetBacktrace();
-        ImGui::InputTextMultiline("##as", (char *)s.c_str(), s.size(), ImVec2(ImGui::GetWindowWidth(), 0), ImGuiInputTextFlags_ReadOnly);
-    }
+DebugView CodeViewer::GetView() {
+    DebugView v;
+    v.break_points = break_points;
+    v.hit_line = hit_line;
+    v.hit_count = hit_count;
+    v.backtrace = emulator.chipset.cpu.GetBacktrace();
+    return v;
 }
 
-static bool step_debug = false, trace_debug = false;
+void CodeViewer::DrawMonitor() {
+    std::string &s = view.backtrace;
+    ImGui::InputTextMultiline("##as", (char *)s.c_str(), s.size(), ImVec2(ImGui::GetWindowWidth(), 0), ImGuiInputTextFlags_ReadOnly);
+}
 
 void CodeViewer::DrawWindow() {
+    // The emulation thread copies its state for the next frame while this one
+    // draws the last copy.
+    if (view_request.valid() && view_request.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        view = view_request.get();
+        if (view.hit_count != shown_hit_count) {
+            shown_hit_count = view.hit_count;
+            cur_col = view.hit_line;
+            need_roll = true;
+        }
+    }
+    if (!view_request.valid())
+        view_request = emulator.Submit([this] {
+            return GetView();
+        });
 
     int h = ImGui::GetTextLineHeight() + 4;
     int w = ImGui::CalcTextSize("F").x;
@@ -225,7 +259,13 @@ void CodeViewer::DrawWindow() {
     DrawMonitor();
     // ImGui::EndChild();
     ImGui::End();
-    debug_flags = DEBUG_BREAKPOINT | (step_debug ? DEBUG_STEP : 0) | (trace_debug ? DEBUG_RET_TRACE : 0);
+    uint8_t flags = DEBUG_BREAKPOINT | (step_debug ? DEBUG_STEP : 0) | (trace_debug ? DEBUG_RET_TRACE : 0);
+    if (flags != shown_debug_flags) {
+        shown_debug_flags = flags;
+        emulator.Post([this, flags] {
+            debug_flags = flags;
+        });
+    }
 }
 
 void CodeViewer::JumpTo(uint8_t seg, uint16_t offset) {
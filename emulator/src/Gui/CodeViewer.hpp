@@ -2,9 +2,12 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <future>
 #include <map>
 #include <string>
 #include <vector>
+#include "../Debugger.hpp"
+#include "../Emulator.hpp"
 typedef struct{
     uint8_t segment;
     uint16_t offset;
@@ -16,10 +19,28 @@ enum EmuDebugFlag{
     DEBUG_STEP=2,
     DEBUG_RET_TRACE=4
 };
-class CodeViewer
+// What the GUI shows of the debugger's state, see CodeViewer::GetView.
+struct DebugView {
+    std::map<int,uint8_t> break_points;
+    // Line of the break point hit last, and how many were hit so far.
+    int hit_line = 0;
+    size_t hit_count = 0;
+    std::string backtrace;
+};
+class CodeViewer : public casioemu::Debugger
 { 
     private:
+        casioemu::Emulator &emulator;
+        // Owned by the emulation thread (BreakAt runs there), the GUI changes
+        // them through Emulator::Post and draws from `view`.
         std::map<int,uint8_t> break_points;
+        int hit_line = 0;
+        size_t hit_count = 0;
+        uint8_t debug_flags = DEBUG_BREAKPOINT;
+        DebugView view;
+        std::future<DebugView> view_request;
+        size_t shown_hit_count = 0;
+        uint8_t shown_debug_flags = DEBUG_BREAKPOINT;
         std::vector<CodeElem> codes;
         size_t rows;
         std::string src_path;
@@ -32,12 +53,16 @@ class CodeViewer
         bool edit_active = false;
         bool need_roll = false;
         uint32_t selected_addr = -1;
+        bool step_debug = false, trace_debug = false;
+
+        DebugView GetView();
 
     public:
-        uint8_t debug_flags = DEBUG_BREAKPOINT;
-        CodeViewer(std::string path);
+        CodeViewer(casioemu::Emulator &emulator, std::string path);
         ~CodeViewer();
         bool TryTrigBP(uint8_t seg,uint16_t offset,bool bp_mode=true);
+        bool BreakAt(uint8_t segment, uint16_t offset) override;
+        bool BreakOnReturn(uint8_t segment, uint16_t offset) override;
         CodeElem LookUp(uint8_t seg,uint16_t offset,int *idx=0);
         void DrawWindow();
         void DrawContent();
@@ -6,22 +6,35 @@
 #include "imgui/imgui_impl_sdl2.h"
 #include "imgui/imgui_impl_sdlrenderer2.h"
 #include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <iostream>
+#include <vector>
 #include "ui.hpp"
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 
 #include "hex.hpp"
 
-char *n_ram_buffer=nullptr;
-casioemu::MMU *me_mmu = nullptr;
-CodeViewer *code_viewer=nullptr;
+#include "../Chipset/Chipset.hpp"
+#include "../Peripheral/BatteryBackedRAM.hpp"
+
+// * The emulator the GUI is attached to, and its code viewer.
+static casioemu::Emulator *gui_emulator = nullptr;
+static CodeViewer *code_viewer = nullptr;
 static SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
 static SDL_Window* window;
 static SDL_Renderer* renderer;
 static ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
+
+// * Memory shown by the memory editor, copied on the emulation thread.
+struct MemorySnapshot {
+    std::vector<ImU8> data, readable;
+};
+
 void gui_loop(){
-    if(!m_emu->Running())
+    if(!gui_emulator->Running())
         return;
 
     //cv.LookUp(1, 0x1235);
@@ -32,10 +45,63 @@ void gui_loop(){
     ImGui::NewFrame();
     
     static MemoryEditor mem_edit;
-    if(n_ram_buffer!=nullptr&&me_mmu!=nullptr){
+    static std::vector<ImU8> mem_copy, mem_readable;
+    static std::future<MemorySnapshot> mem_request;
+    {
         //std::cout<<"renderhex!";
-        int n_ram_base = m_emu->hardware_id == casioemu::HW_ES_PLUS ? 0x8000 : m_emu->hardware_id == casioemu::HW_CLASSWIZ ? 0xD000 : 0x9000;
-        mem_edit.DrawWindow(me_mmu,"Memory Editor", n_ram_buffer, 0x10000 - n_ram_base, n_ram_base);
+        casioemu::Chipset &chipset = gui_emulator->chipset;
+        int n_ram_base = gui_emulator->hardware_id == casioemu::HW_ES_PLUS ? 0x8000 : gui_emulator->hardware_id == casioemu::HW_CLASSWIZ ? 0xD000 : 0x9000;
+        // This thread doesn't own the machine, and SFR reads have side
+        // effects (key latches, peripheral syncs, memory errors). So the
+        // editor shows a copy of the plain memory in the rows it drew last
+        // time, made by the emulation thread and picked up once it's done,
+        // SFRs as unreadable, and edits go to the emulation thread as input.
+        size_t mem_size = 0x10000 - n_ram_base;
+        mem_copy.resize(mem_size);
+        mem_readable.resize(mem_size);
+        if (mem_request.valid() && mem_request.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            MemorySnapshot snapshot = mem_request.get();
+            mem_copy.swap(snapshot.data);
+            mem_readable.swap(snapshot.readable);
+        }
+        if (!mem_request.valid()) {
+            size_t copy_start = mem_edit.VisibleStartAddr, copy_end = mem_edit.VisibleEndAddr;
+            if (copy_start >= copy_end)
+            {
+                // * Nothing drawn yet.
+                copy_start = 0;
+                copy_end = std::min<size_t>(mem_size, 0x400);
+            }
+            size_t preview_addr = mem_edit.DataPreviewAddr;
+            mem_request = gui_emulator->Submit([mem_size, n_ram_base, copy_start, copy_end, preview_addr] {
+                casioemu::MMU &mmu = gui_emulator->chipset.mmu;
+                MemorySnapshot snapshot;
+                snapshot.data.resize(mem_size);
+                snapshot.readable.resize(mem_size);
+                for (size_t ix = copy_start; ix != copy_end; ++ix)
+                    snapshot.readable[ix] = mmu.PeekData(n_ram_base + ix, snapshot.data[ix]);
+                // * The data preview may look past the visible rows.
+                for (size_t ix = preview_addr; ix < mem_size && ix - preview_addr != 8; ++ix)
+                    snapshot.readable[ix] = mmu.PeekData(n_ram_base + ix, snapshot.data[ix]);
+                return snapshot;
+            });
+        }
+        mem_edit.ReadFn = [](const ImU8 *data, size_t off) {
+            return data[off];
+        };
+        mem_edit.ReadableFn = [](const ImU8 *, size_t off) {
+            return mem_readable[off] != 0;
+        };
+        mem_edit.WriteFn = [](ImU8 *data, size_t off, ImU8 d) {
+            data[off] = d;
+            int ram_base = gui_emulator->hardware_id == casioemu::HW_ES_PLUS ? 0x8000 : gui_emulator->hardware_id == casioemu::HW_CLASSWIZ ? 0xD000 : 0x9000;
+            casioemu::Emulator::InputEvent input(casioemu::Emulator::InputEvent::IE_WRITE_DATA, ram_base + off);
+            input.data.push_back(d);
+            gui_emulator->Post([input] {
+                gui_emulator->Input(input);
+            });
+        };
+        mem_edit.DrawWindow(&chipset.mmu,"Memory Editor", mem_copy.data(), mem_copy.size(), n_ram_base);
     }
     code_viewer->DrawWindow();
     
@@ -48,7 +114,7 @@ void gui_loop(){
     ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData());
     SDL_RenderPresent(renderer);
 }
-int test_gui(bool* guiCreated){
+int test_gui(casioemu::Emulator &emulator, bool* guiCreated){
     //SDL_Delay(1000*5);
     window = SDL_CreateWindow("CasioEmuX", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, window_flags);
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_ACCELERATED);
@@ -81,9 +147,11 @@ int test_gui(bool* guiCreated){
     // bool done = false;
 
     *guiCreated = true;
-    while(!m_emu)
-        ;
-    code_viewer=new CodeViewer(m_emu->GetModelFilePath("_disas.txt"));
+    gui_emulator = &emulator;
+    code_viewer=new CodeViewer(emulator, emulator.GetModelFilePath("_disas.txt"));
+    emulator.Post([&emulator] {
+        emulator.debugger = code_viewer;
+    });
 
     return 0;
     //ImGui_ImplSDL2_InitForSDLRenderer(renderer);
@@ -93,8 +93,10 @@ struct MemoryEditor
     ImU8            (*ReadFn)(const ImU8* data, size_t off);    // = 0      // optional handler to read bytes.
     void            (*WriteFn)(ImU8* data, size_t off, ImU8 d); // = 0      // optional handler to write bytes.
     bool            (*HighlightFn)(const ImU8* data, size_t off);//= 0      // optional handler to return Highlight property (to support non-contiguous highlighting).
+    bool            (*ReadableFn)(const ImU8* data, size_t off); //= 0      // optional handler to tell whether a byte can be shown; unreadable bytes are drawn as "--".
 
     // [Internal State]
+    size_t          VisibleStartAddr, VisibleEndAddr;           //          // bytes drawn by the last DrawContents(), so that only those need to be fetched.
     bool            ContentsWidthChanged;
     size_t          DataPreviewAddr;
     size_t          DataEditingAddr;
@@ -125,8 +127,10 @@ struct MemoryEditor
         ReadFn = NULL;
         WriteFn = NULL;
         HighlightFn = NULL;
+        ReadableFn = NULL;
 
         // State/Internals
+        VisibleStartAddr = VisibleEndAddr = 0;
         ContentsWidthChanged = false;
         DataPreviewAddr = DataEditingAddr = (size_t)-1;
         DataEditingTakeFocus = false;
@@ -270,7 +274,15 @@ struct MemoryEditor
         const char* format_byte = OptUpperCaseHex ? "%02X" : "%02x";
         const char* format_byte_space = OptUpperCaseHex ? "%02X " : "%02x ";
 
+        VisibleStartAddr = mem_size;
+        VisibleEndAddr = 0;
         while (clipper.Step())
+        {
+            size_t step_start = (size_t)clipper.DisplayStart * Cols, step_end = (size_t)clipper.DisplayEnd * Cols;
+            if (step_start < VisibleStartAddr)
+                VisibleStartAddr = step_start;
+            if (step_end > VisibleEndAddr)
+                VisibleEndAddr = step_end < mem_size ? step_end : mem_size;
             for (int line_i = clipper.DisplayStart; line_i < clipper.DisplayEnd; line_i++) // display only visible lines
             {
                 size_t addr = (size_t)(line_i * Cols);
@@ -370,7 +382,9 @@ struct MemoryEditor
                         // NB: The trailing space is not visible but ensure there's no gap that the mouse cannot click on.
                         ImU8 b = ReadFn ? ReadFn(mem_data, addr) : (ImU8)mmu->ReadData(base_display_addr + addr, false);
 
-                        if (OptShowHexII)
+                        if (ReadableFn && !ReadableFn(mem_data, addr))
+                            ImGui::TextDisabled("-- ");
+                        else if (OptShowHexII)
                         {
                             if ((b >= 32 && b < 128))
                                 ImGui::Text(".%c ", b);
@@ -417,12 +431,13 @@ struct MemoryEditor
                             draw_list->AddRectFilled(pos, ImVec2(pos.x + s.GlyphWidth, pos.y + s.LineHeight), ImGui::GetColorU32(ImGuiCol_TextSelectedBg));
                         }
                         unsigned char c = ReadFn ? ReadFn(mem_data, addr) : (ImU8)mmu->ReadData(base_display_addr + addr, false);
-                        char display_c = (c < 32 || c >= 128) ? '.' : c;
+                        char display_c = (c < 32 || c >= 128 || (ReadableFn && !ReadableFn(mem_data, addr))) ? '.' : c;
                         draw_list->AddText(pos, (display_c == c) ? color_text : color_disabled, &display_c, &display_c + 1);
                         pos.x += s.GlyphWidth;
                     }
                 }
             }
+        }
         ImGui::PopStyleVar(2);
         ImGui::EndChild();
 
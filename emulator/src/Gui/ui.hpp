@@ -2,10 +2,6 @@
 #include "../Emulator.hpp"
 #include "../Chipset/MMU.hpp"
 #include "CodeViewer.hpp"
-int test_gui(bool* guiCreated);
+int test_gui(casioemu::Emulator &emulator, bool* guiCreated);
 void gui_cleanup();
-void gui_loop();
-extern char *n_ram_buffer;
-extern casioemu::MMU* me_mmu;
-extern casioemu::Emulator *m_emu;
-extern CodeViewer *code_viewer;
\ No newline at end of file
+void gui_loop();
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#ifndef CASIOEMU_HEADLESS
 #include <editline/readline.h>
+#endif
 
 namespace casioemu
 {
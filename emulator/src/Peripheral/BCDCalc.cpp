@@ -6,6 +6,7 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 namespace casioemu
 {
@@ -24,26 +25,10 @@ namespace casioemu
 			bcdcalc->F400_write = true;
 		}, emulator);
 
-		region_param1.Setup(0xF480, 12, "BCDCalc/param1", data_param1, [](MMURegion* region, size_t offset) {
-			return ((uint8_t*)region->userdata)[offset - region->base];
-		}, [](MMURegion* region, size_t offset, uint8_t data) {
-			((uint8_t*)region->userdata)[offset - region->base] = data;
-		}, emulator);
-		region_param2.Setup(0xF4A0, 12, "BCDCalc/param2", data_param2, [](MMURegion* region, size_t offset) {
-			return ((uint8_t*)region->userdata)[offset - region->base];
-		}, [](MMURegion* region, size_t offset, uint8_t data) {
-			((uint8_t*)region->userdata)[offset - region->base] = data;
-		}, emulator);
-		region_temp1.Setup(0xF4C0, 12, "BCDCalc/temp1", data_temp1, [](MMURegion* region, size_t offset) {
-			return ((uint8_t*)region->userdata)[offset - region->base];
-		}, [](MMURegion* region, size_t offset, uint8_t data) {
-			((uint8_t*)region->userdata)[offset - region->base] = data;
-		}, emulator);
-		region_temp2.Setup(0xF4E0, 12, "BCDCalc/temp2", data_temp2, [](MMURegion* region, size_t offset) {
-			return ((uint8_t*)region->userdata)[offset - region->base];
-		}, [](MMURegion* region, size_t offset, uint8_t data) {
-			((uint8_t*)region->userdata)[offset - region->base] = data;
-		}, emulator);
+		region_param1.Setup(0xF480, 12, "BCDCalc/param1", data_param1, MMURegion::LA_READ_WRITE, emulator);
+		region_param2.Setup(0xF4A0, 12, "BCDCalc/param2", data_param2, MMURegion::LA_READ_WRITE, emulator);
+		region_temp1.Setup(0xF4C0, 12, "BCDCalc/temp1", data_temp1, MMURegion::LA_READ_WRITE, emulator);
+		region_temp2.Setup(0xF4E0, 12, "BCDCalc/temp2", data_temp2, MMURegion::LA_READ_WRITE, emulator);
 
 		region_F410.Setup(0xF410, 1, "BCDCalc/F410", &data_F410, MMURegion::DefaultRead<uint8_t>, MMURegion::DefaultWrite<uint8_t>, emulator);
 		region_F414.Setup(0xF414, 1, "BCDCalc/F414", &data_F414, MMURegion::DefaultRead<uint8_t>, MMURegion::DefaultWrite<uint8_t>, emulator);
@@ -1078,6 +1063,9 @@ namespace casioemu
 			F405_write = false;
 		}
 	}
+	size_t BCDCalc::GetIdleTicks() {
+		return F400_write || F402_write || F404_write || F405_write ? 0 : idle_forever;
+	}
 	void BCDCalc::Reset() {
 		F400_write = false;
 		F402_write = false;
@@ -1089,4 +1077,40 @@ namespace casioemu
 		data_F404 = 0;
 		data_F405 = 0;
 	}
+
+	void BCDCalc::SerializeState(StateArchive &archive) {
+		archive.Section("BCDCalc");
+		Peripheral::SerializeState(archive);
+		archive.Field(data_F400);
+		archive.Field(data_F402);
+		archive.Field(data_F404);
+		archive.Field(data_F405);
+		archive.Field(data_F410);
+		archive.Field(data_F414);
+		archive.Field(data_F415);
+		archive.Field(data_param1);
+		archive.Field(data_param2);
+		archive.Field(data_temp1);
+		archive.Field(data_temp2);
+		archive.Field(F400_write);
+		archive.Field(F402_write);
+		archive.Field(F404_write);
+		archive.Field(F405_write);
+		archive.Field(data_operator);
+		archive.Field(data_type_1);
+		archive.Field(data_type_2);
+		archive.Field(param1);
+		archive.Field(param2);
+		archive.Field(param3);
+		archive.Field(param4);
+		archive.Field(data_F404_copy);
+		archive.Field(data_mode);
+		archive.Field(data_repeat_flag);
+		archive.Field(data_a);
+		archive.Field(data_b);
+		archive.Field(data_c);
+		archive.Field(data_d);
+		archive.Field(data_F402_copy);
+		archive.Field(data_F405_copy);
+	}
 }
@@ -30,7 +30,9 @@ namespace casioemu
 
 		void Initialise();
 		void Reset();
+		void SerializeState(StateArchive &archive);
 		void Tick();
+		size_t GetIdleTicks();
 
 		void GenerateParams();
 		void F405control();
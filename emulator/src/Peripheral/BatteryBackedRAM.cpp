@@ -5,7 +5,7 @@
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
 #include "../Logger.hpp"
-#include "../Gui/ui.hpp"
+#include "../Data/StateArchive.hpp"
 #include <fstream>
 #include <cstring>
 
@@ -29,9 +29,16 @@ namespace casioemu
 		if (!real_hardware)
 			ram_size += 0x100;
 
-		ram_buffer = new uint8_t[ram_size];
-		for (size_t ix = 0; ix != ram_size; ++ix)
-			ram_buffer[ix] = 0;
+		base = emulator.hardware_id == HW_ES_PLUS ? 0x8000 : emulator.hardware_id == HW_CLASSWIZ ? 0xD000 : 0x9000;
+		base_2 = real_hardware ? 0 : emulator.hardware_id == HW_ES_PLUS ? 0x9800 : emulator.hardware_id == HW_CLASSWIZ ? 0x49800 : 0x89800;
+		page_count = ram_size / page_size;
+		pages.reset(new RAMPage[page_count]);
+		for (size_t ix = 0; ix != page_count; ++ix)
+		{
+			pages[ix].data = std::make_shared<PageData>();
+			pages[ix].data->fill(0);
+			MapPage(ix, true);
+		}
 
 		ram_file_requested = false;
 		if (emulator.argv_map.find("ram") != emulator.argv_map.end())
@@ -39,65 +46,146 @@ namespace casioemu
 			ram_file_requested = true;
 
 			if (emulator.argv_map.find("clean_ram") == emulator.argv_map.end())
-				LoadRAMImage();
+				LoadRAMImage(emulator.argv_map["ram"]);
 		}
+	}
 
-		region.Setup(emulator.hardware_id == HW_ES_PLUS ? 0x8000 : emulator.hardware_id == HW_CLASSWIZ ? 0xD000 : 0x9000,
-			emulator.hardware_id == HW_ES_PLUS ? 0x0E00 : emulator.hardware_id == HW_CLASSWIZ ? 0x2000 : 0x6000 ,
-			"BatteryBackedRAM", ram_buffer, [](MMURegion *region, size_t offset) {
-			return ((uint8_t *)region->userdata)[offset - region->base];
-		}, [](MMURegion *region, size_t offset, uint8_t data) {
-			((uint8_t *)region->userdata)[offset - region->base] = data;
-		}, emulator);
-		if (!real_hardware)
-			region_2.Setup(emulator.hardware_id == HW_ES_PLUS ? 0x9800 : emulator.hardware_id == HW_CLASSWIZ ? 0x49800 : 0x89800, 0x0100,
-				"BatteryBackedRAM/2", ram_buffer + ram_size - 0x100, [](MMURegion* region, size_t offset) {
-					return ((uint8_t*)region->userdata)[offset - region->base];
-				}, [](MMURegion* region, size_t offset, uint8_t data) {
-					((uint8_t*)region->userdata)[offset - region->base] = data;
-				}, emulator);
-		n_ram_buffer =(char*) ram_buffer;
-		logger::Info("inited hex editor!\n");
+	size_t BatteryBackedRAM::PageBase(size_t index)
+	{
+		if (base_2 && index == page_count - 1)
+			return base_2;
+		return base + index * page_size;
+	}
+
+	void BatteryBackedRAM::MapPage(size_t index, bool writable)
+	{
+		RAMPage &page = pages[index];
+		if (page.region.setup_done)
+		{
+			if (page.writable == writable)
+				return;
+			page.region.Kill();
+		}
+
+		page.writable = writable;
+		page.region.Setup(PageBase(index), page_size, base_2 && index == page_count - 1 ? "BatteryBackedRAM/2" : "BatteryBackedRAM",
+			page.data->data(), writable ? MMURegion::LA_READ_WRITE : MMURegion::LA_READ_ONLY, emulator, CopyOnWrite);
+	}
+
+	void BatteryBackedRAM::UnsharePage(size_t index)
+	{
+		RAMPage &page = pages[index];
+		// * Pages are only handed out by `ShareRAM` and `RestoreRAM`, which
+		//   map them read-only, so a writable page is this emulator's own.
+		//   A read-only page is copied even if nobody else holds it anymore:
+		//   other threads drop their references without this emulator's
+		//   lock, and the reference count doesn't say whether they are done
+		//   reading.
+		if (!page.writable)
+		{
+			page.data = std::make_shared<PageData>(*page.data);
+			page.region.Kill();
+		}
+		MapPage(index, true);
+	}
+
+	void BatteryBackedRAM::CopyOnWrite(MMURegion *region, size_t offset, uint8_t data)
+	{
+		BatteryBackedRAM *ram = region->emulator->chipset.battery_backed_ram;
+		size_t index = region->base == ram->base_2 ? ram->page_count - 1 : (region->base - ram->base) / page_size;
+		ram->UnsharePage(index);
+		(*ram->pages[index].data)[offset - region->base] = data;
+	}
+
+	BatteryBackedRAM::RAMPages BatteryBackedRAM::ShareRAM()
+	{
+		RAMPages ram_pages;
+		for (size_t ix = 0; ix != page_count; ++ix)
+		{
+			MapPage(ix, false);
+			ram_pages.push_back(pages[ix].data);
+		}
+		return ram_pages;
+	}
+
+	bool BatteryBackedRAM::RestoreRAM(const RAMPages &ram_pages)
+	{
+		if (ram_pages.size() != page_count)
+			return false;
+
+		for (size_t ix = 0; ix != page_count; ++ix)
+		{
+			if (pages[ix].data == ram_pages[ix])
+			{
+				MapPage(ix, false);
+				continue;
+			}
+			pages[ix].region.Kill();
+			pages[ix].data = ram_pages[ix];
+			MapPage(ix, false);
+		}
+		return true;
 	}
 
 	void BatteryBackedRAM::Uninitialise()
 	{
 		if (ram_file_requested && emulator.argv_map.find("preserve_ram") == emulator.argv_map.end())
-			SaveRAMImage();
+			SaveRAMImage(emulator.argv_map["ram"]);
+	}
 
-		delete[] ram_buffer;
+	void BatteryBackedRAM::SerializeState(StateArchive &archive)
+	{
+		archive.Section("BatteryBackedRAM");
+		Peripheral::SerializeState(archive);
+		// * The pages are shared instead (see `ShareRAM`).
+		if (archive.SharesRAM())
+			return;
+
+		for (size_t ix = 0; ix != page_count; ++ix)
+		{
+			if (archive.Loading())
+				UnsharePage(ix);
+			archive.Bytes(pages[ix].data->data(), page_size);
+		}
 	}
 
-	void BatteryBackedRAM::SaveRAMImage()
+	bool BatteryBackedRAM::SaveRAMImage(const std::string &path)
 	{
-		std::ofstream ram_handle(emulator.argv_map["ram"], std::ofstream::binary);
+		std::ofstream ram_handle(path, std::ofstream::binary);
 		if (ram_handle.fail())
 		{
 			logger::Info("[BatteryBackedRAM] std::ofstream failed: %s\n", std::strerror(errno));
-			return;
+			return false;
 		}
-		ram_handle.write((char *)ram_buffer, ram_size);
+		for (size_t ix = 0; ix != page_count; ++ix)
+			ram_handle.write((char *)pages[ix].data->data(), page_size);
 		if (ram_handle.fail())
 		{
 			logger::Info("[BatteryBackedRAM] std::ofstream failed: %s\n", std::strerror(errno));
-			return;
+			return false;
 		}
+		return true;
 	}
 
-	void BatteryBackedRAM::LoadRAMImage()
+	bool BatteryBackedRAM::LoadRAMImage(const std::string &path)
 	{
-		std::ifstream ram_handle(emulator.argv_map["ram"], std::ifstream::binary);
+		std::ifstream ram_handle(path, std::ifstream::binary);
 		if (ram_handle.fail())
 		{
 			logger::Info("[BatteryBackedRAM] std::ifstream failed: %s\n", std::strerror(errno));
-			return;
+			return false;
+		}
+		for (size_t ix = 0; ix != page_count; ++ix)
+		{
+			UnsharePage(ix);
+			ram_handle.read((char *)pages[ix].data->data(), page_size);
 		}
-		ram_handle.read((char *)ram_buffer, ram_size);
 		if (ram_handle.fail())
 		{
 			logger::Info("[BatteryBackedRAM] std::ifstream failed: %s\n", std::strerror(errno));
-			return;
+			return false;
 		}
+		return true;
 	}
 }
 
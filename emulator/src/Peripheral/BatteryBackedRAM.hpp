@@ -4,22 +4,68 @@
 #include "Peripheral.hpp"
 #include "../Chipset/MMURegion.hpp"
 
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace casioemu
 {
 	class BatteryBackedRAM : public Peripheral
 	{
-		MMURegion region, region_2;
+	public:
+		static const size_t page_size = 0x100;
+		typedef std::array<uint8_t, page_size> PageData;
+		typedef std::vector<std::shared_ptr<PageData>> RAMPages;
+
+	private:
+		/**
+		 * RAM is kept in pages, each mapped as a region of its own, so that
+		 * forked emulators (see `Emulator::Fork`) and snapshots (see
+		 * `Emulator::Rewind`) can share them. A shared page is mapped
+		 * read-only and copied on the first write; `writable` is only set on
+		 * pages that belong to this emulator alone.
+		 */
+		struct RAMPage
+		{
+			MMURegion region;
+			std::shared_ptr<PageData> data;
+			bool writable;
+		};
+		std::unique_ptr<RAMPage[]> pages;
+		size_t page_count;
+		// * The last page is mapped at `base_2` if there's a second region.
+		size_t base, base_2;
 
 		size_t ram_size;
 		bool ram_file_requested;
 
+		size_t PageBase(size_t index);
+		void MapPage(size_t index, bool writable);
+		/**
+		 * Gives the page its own copy of the data if it's shared, and maps it
+		 * read-write.
+		 */
+		void UnsharePage(size_t index);
+		static void CopyOnWrite(MMURegion *region, size_t offset, uint8_t data);
+
 	public:
 		using Peripheral::Peripheral;
-		uint8_t *ram_buffer;
 		void Initialise();
 		void Uninitialise();
-		void SaveRAMImage();
-		void LoadRAMImage();
+		void SerializeState(StateArchive &archive);
+		bool SaveRAMImage(const std::string &path);
+		bool LoadRAMImage(const std::string &path);
+		/**
+		 * Returns the pages of the RAM, which are shared from now on: this
+		 * costs nothing until the pages are written to.
+		 */
+		RAMPages ShareRAM();
+		/**
+		 * Makes the RAM share `pages`, from `ShareRAM` of RAM of the same
+		 * size. Returns false if the size doesn't match.
+		 */
+		bool RestoreRAM(const RAMPages &ram_pages);
 	};
 }
 
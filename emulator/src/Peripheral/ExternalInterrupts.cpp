@@ -54,6 +54,26 @@ namespace casioemu
         }
     }
 
+    size_t ExternalInterrupts::GetIdleTicks() {
+        //Only the level triggered modes raise interrupts on ticks.
+        for(int index = 0; index < 3; index++) {
+            switch ((emulator.chipset.data_EXICON >> (2 * index + 2)) & 0x03)
+            {
+            case 2:
+                if(emulator.chipset.Port0Inputlevel[index])
+                    return 0;
+                break;
+            case 3:
+                if(!emulator.chipset.Port0Inputlevel[index])
+                    return 0;
+                break;
+            default:
+                break;
+            }
+        }
+        return idle_forever;
+    }
+
     void ExternalInterrupts::Reset() {
         emulator.chipset.data_EXICON = 0;
     }
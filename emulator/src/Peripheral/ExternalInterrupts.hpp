@@ -21,5 +21,6 @@ namespace casioemu
 		void Initialise();
 		void Reset();
 		void Tick();
+		size_t GetIdleTicks();
 	};
 }
@@ -4,6 +4,7 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 namespace casioemu
 {
@@ -161,4 +162,20 @@ namespace casioemu
             emulator.chipset.Port1Outputlevel[i] = false;
         }
     }
-}
\ No newline at end of file
+
+    void IOPorts::SerializeState(StateArchive &archive) {
+        archive.Section("IOPorts");
+        Peripheral::SerializeState(archive);
+        archive.Field(port0_mode);
+        archive.Field(port0_control_0);
+        archive.Field(port0_control_1);
+        archive.Field(port0_direction);
+        archive.Field(port1_mode_0);
+        archive.Field(port1_mode_1);
+        archive.Field(port1_control_0);
+        archive.Field(port1_control_1);
+        archive.Field(port1_direction);
+        archive.Field(port0_output);
+        archive.Field(port1_output);
+    }
+}
@@ -42,5 +42,6 @@ namespace casioemu
 
 		void Initialise();
 		void Reset();
+		void SerializeState(StateArchive &archive);
 	};
 }
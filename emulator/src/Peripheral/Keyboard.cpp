@@ -5,10 +5,10 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
+#include <algorithm>
 #include <fstream>
-#include <thread>
-#include <chrono>
 #include <lua.hpp>
 #include <SDL.h>
 
@@ -126,13 +126,13 @@ namespace casioemu
 				return 0;
 			}
 			uint8_t code = lua_tointeger(lua_state, 2);
-			keyboard->PressButtonByCode(code);
+			keyboard->emulator.Input(Emulator::InputEvent(Emulator::InputEvent::IE_PRESS_KEY, 0, code));
 			return 0;
 		});
 		lua_setfield(emulator.lua_state, -2, "PressKey");
 		lua_pushcfunction(emulator.lua_state, [](lua_State *lua_state) {
 			Keyboard *keyboard = *(Keyboard **)lua_topointer(lua_state, 1);
-			keyboard->ReleaseAll();
+			keyboard->emulator.Input(Emulator::InputEvent(Emulator::InputEvent::IE_RELEASE_ALL_KEYS));
 			return 0;
 		});
 		lua_setfield(emulator.lua_state, -2, "ReleaseAll");
@@ -142,25 +142,23 @@ namespace casioemu
 				logger::Info("Injector already triggered!\n");
 				return 0;
 			}
+			int press_time = 100;
+			int delay_time = 150;
 			switch(lua_gettop(lua_state)) {
 				case 2:
-					keyboard->PressTime = 100;
-					keyboard->DelayTime = 150;
 					break;
 				case 3:
-					keyboard->PressTime = lua_tointeger(lua_state, 3);
-					keyboard->DelayTime = 150;
+					press_time = lua_tointeger(lua_state, 3);
 					break;
 				case 4:
-					keyboard->PressTime = lua_tointeger(lua_state, 3);
-					keyboard->DelayTime = lua_tointeger(lua_state, 4);
+					press_time = lua_tointeger(lua_state, 3);
+					delay_time = lua_tointeger(lua_state, 4);
 					break;
 				default:
 					logger::Info("Invalid argument num!\n");
 					return 0;
 			}
-			keyboard->keyseq_filename = lua_tostring(lua_state, 2);
-			keyboard->StartInject();
+			keyboard->StartInject(lua_tostring(lua_state, 2), press_time, delay_time);
 			return 0;
 		});
 		lua_setfield(emulator.lua_state, -2, "KeyInject");
@@ -303,8 +301,52 @@ namespace casioemu
 		RecalculateGhost();
 	}
 
+	void Keyboard::SerializeState(StateArchive &archive)
+	{
+		archive.Section("Keyboard");
+		Peripheral::SerializeState(archive);
+		archive.Field(keyboard_out);
+		archive.Field(keyboard_out_mask);
+		archive.Field(keyboard_in);
+		archive.Field(input_mode);
+		archive.Field(input_filter);
+		archive.Field(keyboard_ghost);
+		archive.Field(ki_ghost);
+		archive.Field(keyboard_in_last);
+		archive.Field(input_filter_last);
+		archive.Field(keyboard_ready_emu);
+		archive.Field(keyboard_out_emu);
+		archive.Field(keyboard_in_emu);
+		archive.Field(keyboard_pd_emu);
+		archive.Field(emu_ki_readcount);
+		archive.Field(emu_ko_readcount);
+		archive.Field(has_input);
+		archive.Field(p0);
+		archive.Field(p1);
+		archive.Field(p146);
+		for (auto &button : buttons)
+		{
+			archive.Field(button.pressed);
+			archive.Field(button.stuck);
+		}
+
+		archive.Field(isInjectorTriggered);
+		archive.Field(inject_sequence);
+		archive.Field(inject_index);
+		archive.Field(inject_press_cycles);
+		archive.Field(inject_delay_cycles);
+		archive.Field(inject_countdown);
+		archive.Field(inject_pressed);
+
+		if (archive.Loading())
+			require_frame = true;
+	}
+
 	void Keyboard::Tick()
 	{
+		if (isInjectorTriggered)
+			TickInjector();
+
 		switch(emulator.chipset.data_EXICON & 0x03) {
 			case 0:
 				input_filter_last &= input_filter;
@@ -331,21 +373,57 @@ namespace casioemu
 		keyboard_in_last = keyboard_in;
 	}
 
-	void Keyboard::Frame()
+	size_t Keyboard::GetIdleTicks()
+	{
+		switch(emulator.chipset.data_EXICON & 0x03) {
+			case 2:
+				if(input_filter & keyboard_in)
+					return 0;
+				break;
+			case 3:
+				if(input_filter & ~keyboard_in)
+					return 0;
+				break;
+			default:
+				break;
+		}
+		// * Edges can only show up once KI or the filter changes.
+		size_t idle_ticks = keyboard_in == keyboard_in_last && input_filter == input_filter_last ? idle_forever : 0;
+		if (isInjectorTriggered)
+			idle_ticks = std::min(idle_ticks, inject_countdown - 1);
+		return idle_ticks;
+	}
+
+	void Keyboard::SkipTicks(size_t ticks)
+	{
+		if (isInjectorTriggered)
+			inject_countdown -= ticks;
+	}
+
+	void Keyboard::Publish()
 	{
 		require_frame = false;
 
-		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+		std::vector<PressedButton> &pressed = pressed_buttons.Back();
+		pressed.clear();
 		for (auto &button : buttons)
-		{
 			if (button.type != Button::BT_NONE && button.pressed)
-			{
-				if (button.stuck)
-					SDL_SetRenderDrawColor(renderer, 127, 0, 0, 127);
-				else
-					SDL_SetRenderDrawColor(renderer, 0, 0, 0, 127);
-				SDL_RenderFillRect(renderer, &button.rect);
-			}
+				pressed.push_back({button.rect, button.stuck});
+		pressed_buttons.Publish();
+	}
+
+	void Keyboard::Frame()
+	{
+		pressed_buttons.Update();
+
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+		for (auto &button : pressed_buttons.Front())
+		{
+			if (button.stuck)
+				SDL_SetRenderDrawColor(renderer, 127, 0, 0, 127);
+			else
+				SDL_SetRenderDrawColor(renderer, 0, 0, 0, 127);
+			SDL_RenderFillRect(renderer, &button.rect);
 		}
 	}
 
@@ -482,25 +560,67 @@ namespace casioemu
 		}
 	}
 
-	void Keyboard::StartInject() {
-		std::thread inj_t([&]() {
-			isInjectorTriggered = true;
-			std::ifstream keyseq_handle(keyseq_filename, std::ifstream::binary);
-			if(keyseq_handle.fail()) {
-				logger::Info("Failed to load file %s\n", keyseq_filename);
+	void Keyboard::ReleaseButtonByCode(uint8_t code)
+	{
+		int button_index = code == 0xFF ? 63 : ((code >> 1) & 0x38) | (code & 0x07);
+		Button &button = buttons[button_index];
+		if (!button.pressed)
+			return;
+
+		button.pressed = button.stuck = false;
+		if (button.type != Button::BT_BUTTON)
+			return;
+		require_frame = true;
+		if (real_hardware)
+			RecalculateGhost();
+		else
+			has_input = keyboard_in_emu = keyboard_out_emu = 0;
+	}
+
+	bool Keyboard::StartInject(const std::string &path, int press_time, int delay_time) {
+		std::ifstream keyseq_handle(path, std::ifstream::binary);
+		if(keyseq_handle.fail()) {
+			logger::Info("Failed to load file %s\n", path.c_str());
+			return false;
+		}
+		std::vector<uint8_t> keyseq_raw = std::vector<uint8_t>((std::istreambuf_iterator<char>(keyseq_handle)), std::istreambuf_iterator<char>());
+		size_t cycles_per_ms = emulator.GetCyclesPerSecond() / 1000;
+		Emulator::InputEvent input(Emulator::InputEvent::IE_INJECT_KEYS, std::max(press_time, 1) * cycles_per_ms, std::max(delay_time, 1) * cycles_per_ms);
+		input.data = keyseq_raw;
+		emulator.Input(input);
+		return true;
+	}
+
+	void Keyboard::InjectKeys(const std::vector<uint8_t> &sequence, size_t press_cycles, size_t delay_cycles)
+	{
+		inject_sequence = sequence;
+		inject_index = 0;
+		inject_press_cycles = std::max<size_t>(press_cycles, 1);
+		inject_delay_cycles = std::max<size_t>(delay_cycles, 1);
+		inject_countdown = 1;
+		inject_pressed = false;
+		isInjectorTriggered = !sequence.empty();
+		emulator.chipset.InvalidateTickSchedule();
+	}
+
+	void Keyboard::TickInjector()
+	{
+		if (--inject_countdown)
+			return;
+
+		if (inject_pressed)
+		{
+			ReleaseAll();
+			inject_pressed = false;
+			inject_countdown = inject_delay_cycles;
+			if (inject_index == inject_sequence.size())
 				isInjectorTriggered = false;
-				return;
-			}
-			std::vector<unsigned char> keyseq_raw = std::vector<unsigned char>((std::istreambuf_iterator<char>(keyseq_handle)), std::istreambuf_iterator<char>());
-			for(int i = 0; i < (int)keyseq_raw.size(); i++) {
-				PressButtonByCode(keyseq_raw[i]);
-				std::this_thread::sleep_for(std::chrono::milliseconds(PressTime));
-				ReleaseAll();
-				std::this_thread::sleep_for(std::chrono::milliseconds(DelayTime));
-			}
-			isInjectorTriggered = false;
-		});
-		inj_t.detach();
+			return;
+		}
+
+		PressButtonByCode(inject_sequence[inject_index++]);
+		inject_pressed = true;
+		inject_countdown = inject_press_cycles;
 	}
 
 	void Keyboard::StoreKeyLog() {
@@ -596,6 +716,8 @@ namespace casioemu
 
 	void Keyboard::RecalculateKI()
 	{
+		emulator.chipset.InvalidateTickSchedule();
+
 		uint8_t keyboard_out_ghosted = 0;
 		uint8_t ki_pulled_up = 0;
 		for (size_t ix = 0; ix != 7; ++ix)
@@ -4,8 +4,11 @@
 #include "Peripheral.hpp"
 #include "../Chipset/MMURegion.hpp"
 #include "../Chipset/InterruptSource.hpp"
+#include "../Data/TripleBuffer.hpp"
 
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace casioemu
 {
@@ -40,18 +43,38 @@ namespace casioemu
 			bool pressed, stuck;
 		} buttons[64];
 
+		/**
+		 * Buttons drawn as pressed by `Frame`, published by `Publish`.
+		 */
+		struct PressedButton
+		{
+			SDL_Rect rect;
+			bool stuck;
+		};
+		TripleBuffer<std::vector<PressedButton>> pressed_buttons;
+
 		// Maps from keycode to an index to (buttons).
 		std::unordered_map<SDL_Keycode, size_t> keyboard_map;
 
 		bool p0, p1, p146;
 
+		/**
+		 * Key sequence being injected. Timing is counted in emulated cycles
+		 * (this peripheral ticks once per cycle), so injection runs as fast as
+		 * the emulator does.
+		 */
+		std::vector<uint8_t> inject_sequence;
+		size_t inject_index, inject_press_cycles, inject_delay_cycles;
+		// * Ticks until the next key is pressed or released, at least 1.
+		size_t inject_countdown;
+		bool inject_pressed;
+
+		void TickInjector();
+
 	public:
 		using Peripheral::Peripheral;
 
-		const char* keyseq_filename;
 		const char* keylog_filename;
-		int PressTime;
-		int DelayTime;
 		int KeyLogIndex;
 
 		bool isInjectorTriggered;
@@ -61,14 +84,30 @@ namespace casioemu
 
 		void Initialise();
 		void Reset();
+		void SerializeState(StateArchive &archive);
 		void Tick();
+		size_t GetIdleTicks();
+		void SkipTicks(size_t ticks);
+		void Publish();
 		void Frame();
 		void UIEvent(SDL_Event &event);
 		void Uninitialise();
 		void PressButton(Button& button, bool stick);
 		void PressAt(int x, int y, bool stick);
 		void PressButtonByCode(uint8_t code);
-		void StartInject();
+		void ReleaseButtonByCode(uint8_t code);
+		/**
+		 * Loads a key sequence file (one key code per byte) and injects it,
+		 * holding each key for `press_time` and waiting `delay_time` before
+		 * the next one, both in milliseconds of emulated time.
+		 */
+		bool StartInject(const std::string &path, int press_time, int delay_time);
+		/**
+		 * Presses the keys of `sequence` one after another, each for
+		 * `press_cycles` cycles followed by `delay_cycles` cycles with no key
+		 * pressed. Replaces the sequence being injected, if any.
+		 */
+		void InjectKeys(const std::vector<uint8_t> &sequence, size_t press_cycles, size_t delay_cycles);
 		void StoreKeyLog();
 		void ReleaseAll();
 		void RecalculateKI();
@@ -3,6 +3,7 @@
 #include "../Logger.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 #include "../Chipset/CPU.hpp"
 
 #include <sstream>
@@ -64,4 +65,10 @@ namespace casioemu
 	void Miscellaneous::Reset() {
 		
 	}
+
+	void Miscellaneous::SerializeState(StateArchive &archive) {
+		archive.Section("Miscellaneous");
+		Peripheral::SerializeState(archive);
+		archive.Field(data);
+	}
 }
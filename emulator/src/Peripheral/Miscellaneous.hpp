@@ -24,6 +24,7 @@ namespace casioemu
 		void Initialise();
 		void Tick();
 		void Reset();
+		void SerializeState(StateArchive &archive);
 	};
 }
 
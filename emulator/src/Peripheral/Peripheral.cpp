@@ -1,5 +1,7 @@
 #include "Peripheral.hpp"
 
+#include "../Data/StateArchive.hpp"
+
 namespace casioemu
 {
 	Peripheral::Peripheral(Emulator &_emulator) : emulator(_emulator), require_frame(false)
@@ -26,11 +28,24 @@ namespace casioemu
 	{
 	}
 
-	void Peripheral::Frame()
+	size_t Peripheral::GetIdleTicks()
+	{
+		return idle_forever;
+	}
+
+	void Peripheral::SkipTicks(size_t)
+	{
+	}
+
+	void Peripheral::Publish()
 	{
 		require_frame = false;
 	}
 
+	void Peripheral::Frame()
+	{
+	}
+
 	void Peripheral::UIEvent(SDL_Event &)
 	{
 	}
@@ -39,6 +54,13 @@ namespace casioemu
 	{
 	}
 
+	void Peripheral::SerializeState(StateArchive &archive)
+	{
+		archive.Field(require_frame);
+		archive.Field(enabled);
+		archive.Field(clock_type);
+	}
+
 	bool Peripheral::GetRequireFrame()
 	{
 		return require_frame;
@@ -2,10 +2,12 @@
 #include "../Config.hpp"
 
 #include <SDL.h>
+#include <cstdint>
 
 namespace casioemu
 {
 	class Emulator;
+	class StateArchive;
 
 	enum ClockType
 	{
@@ -36,14 +38,45 @@ namespace casioemu
 		int block_bit = -1;
 
 	public:
+		static const size_t idle_forever = SIZE_MAX;
+
 		Peripheral(Emulator &emulator);
 		virtual void Initialise();
 		virtual void Uninitialise();
 		virtual void Tick();
 		virtual void TickAfterInterrupts();
+		/**
+		 * Returns how many of the upcoming ticks of this peripheral's clock
+		 * would do nothing but advance internal counters. The chipset doesn't
+		 * call `Tick` for those and hands them to `SkipTicks` in one go later.
+		 * `idle_forever` means that `Tick` is a no-op until the peripheral's
+		 * state is changed through an SFR or an input; such peripherals aren't
+		 * ticked at all. Peripherals that override `Tick` must override this too.
+		 */
+		virtual size_t GetIdleTicks();
+		/**
+		 * Catches up on `ticks` idle ticks. Never called with more ticks than the
+		 * last `GetIdleTicks` returned.
+		 */
+		virtual void SkipTicks(size_t ticks);
+		/**
+		 * Hands what `Frame` draws over to the renderer's thread and clears
+		 * `require_frame`. Called by the thread that owns the machine.
+		 */
+		virtual void Publish();
+		/**
+		 * Draws what was published last. Runs on the renderer's thread while
+		 * the machine keeps running, so it must not touch anything else.
+		 */
 		virtual void Frame();
 		virtual void UIEvent(SDL_Event &event);
 		virtual void Reset();
+		/**
+		 * Saves or restores (see `StateArchive::Loading`) everything that
+		 * SFRs, memory or emulated time can change. Overrides begin with a
+		 * `Section` tag and call this for the fields of this class.
+		 */
+		virtual void SerializeState(StateArchive &archive);
 		virtual bool GetRequireFrame();
 		virtual void ResetLSCLK();
 		virtual int GetClockType();
@@ -4,8 +4,10 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 #include <cmath>
+#include <cstring>
 
 namespace casioemu {
     void PowerSupply::Initialise() {
@@ -66,14 +68,12 @@ namespace casioemu {
         lua_pushcfunction(emulator.lua_state, [](lua_State *lua_state) {
 			PowerSupply *powersupply = *(PowerSupply **)lua_topointer(lua_state, 1);
             std::string index = lua_tostring(lua_state, 2);
-            if(index == "bt") {
-                powersupply->emulator.BatteryVoltage = lua_tonumber(lua_state, 3);
-                return 0;
-            }
-            if(index == "sp") {
-                powersupply->emulator.SolarPanelVoltage = lua_tonumber(lua_state, 3);
+            if(index != "bt" && index != "sp")
                 return 0;
-            }
+            float voltage = lua_tonumber(lua_state, 3);
+            uint32_t bits;
+            std::memcpy(&bits, &voltage, sizeof(bits));
+            powersupply->emulator.Input(Emulator::InputEvent(index == "bt" ? Emulator::InputEvent::IE_BATTERY_VOLTAGE : Emulator::InputEvent::IE_SOLAR_PANEL_VOLTAGE, 0, bits));
 			return 0;
 		});
         lua_setfield(emulator.lua_state, -2, "__newindex");
@@ -170,6 +170,19 @@ namespace casioemu {
         }
     }
 
+    size_t PowerSupply::GetIdleTicks() {
+        if(isTestRoutineRunning)
+            return 0;
+        if(!BLDControl)
+            return idle_forever;
+        //Waiting for the next test of the repeat mode.
+        return TestTimer + 1 < DelayTicks ? DelayTicks - TestTimer - 1 : 0;
+    }
+
+    void PowerSupply::SkipTicks(size_t ticks) {
+        TestTimer += ticks;
+    }
+
     void PowerSupply::Reset() {
         BLDMode = 0;
         BLDControl = 0;
@@ -179,4 +192,22 @@ namespace casioemu {
         isTestRoutineRunning = false;
         BLDFlag = emulator.BatteryVoltage >= ThreshVoltage[0] ? 1 : 0;
     }
-}
\ No newline at end of file
+
+    void PowerSupply::SerializeState(StateArchive &archive) {
+        archive.Section("PowerSupply");
+        Peripheral::SerializeState(archive);
+        archive.Field(threshold);
+        archive.Field(data_BLDCON2);
+        archive.Field(data_SPIndicator);
+        archive.Field(BLDMode);
+        archive.Field(BLDFlag);
+        archive.Field(BLDControl);
+        archive.Field(isTestRoutineRunning);
+        archive.Field(TestTimer);
+        archive.Field(CurrentTestMode);
+        archive.Field(CurrentRepMode);
+        archive.Field(HasResult);
+        archive.Field(CurrentThresh);
+        archive.Field(DelayTicks);
+    }
+}
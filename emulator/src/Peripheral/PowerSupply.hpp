@@ -39,6 +39,9 @@ namespace casioemu {
 
         void Initialise();
         void Tick();
+        size_t GetIdleTicks();
+        void SkipTicks(size_t ticks);
         void Reset();
+        void SerializeState(StateArchive &archive);
     };
 }
\ No newline at end of file
@@ -12,10 +12,8 @@ namespace casioemu
 {
 	static void SetupROMRegion(MMURegion &region, size_t region_base, size_t size, size_t rom_base, bool strict_memory, Emulator& emulator, std::string description = {})
 	{
-		if (rom_base + size > emulator.chipset.rom_data.size())
+		if (rom_base + size > emulator.chipset.rom_data->size())
 			PANIC("Invalid ROM region: base %zx, size %zx\n", rom_base, size);
-		uint8_t *data = emulator.chipset.rom_data.data();
-		auto offset = (ssize_t) rom_base - (ssize_t) region_base;
 		if (description.empty())
 			description = "ROM/Segment" + std::to_string(region_base >> 16);
 
@@ -25,14 +23,9 @@ namespace casioemu
 		} : [](MMURegion *, size_t, uint8_t) {
 		};
 
-		if (offset >= 0)
-			region.Setup(region_base, size, description, data + offset, [](MMURegion *region, size_t address) {
-				return ((uint8_t *)(region->userdata))[address];
-			}, write_function, emulator);
-		else
-			region.Setup(region_base, size, description, data + rom_base, [](MMURegion *region, size_t address) {
-				return ((uint8_t *)(region->userdata))[address - region->base];
-			}, write_function, emulator);
+		// * LA_READ_ONLY regions never write through `data`, so the shared image stays untouched.
+		uint8_t *rom_image = const_cast<uint8_t *>(emulator.chipset.rom_data->data());
+		region.Setup(region_base, size, description, rom_image + rom_base, MMURegion::LA_READ_ONLY, emulator, write_function);
 	}
 
 	void ROMWindow::Initialise()
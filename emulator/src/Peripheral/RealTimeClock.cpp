@@ -4,6 +4,7 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 namespace casioemu
 {
@@ -192,7 +193,33 @@ namespace casioemu
         }
     }
 
+    size_t RealTimeClock::GetIdleTicks() {
+        //Only the 2Hz and 1Hz outputs of the TBC do anything.
+        return emulator.chipset.LSCLK_output & 0x60 ? 0 : idle_forever;
+    }
+
     void RealTimeClock::Reset() {
         RTCCON = 0;
     }
-}
\ No newline at end of file
+
+    void RealTimeClock::SerializeState(StateArchive &archive) {
+        archive.Section("RealTimeClock");
+        Peripheral::SerializeState(archive);
+        archive.Field(RTCSEC);
+        archive.Field(RTCMIN);
+        archive.Field(RTCHOUR);
+        archive.Field(RTCWEEK);
+        archive.Field(RTCDAY);
+        archive.Field(RTCMON);
+        archive.Field(RTCYEAR);
+        archive.Field(RTCCON);
+        archive.Field(AL0MIN);
+        archive.Field(AL0HOUR);
+        archive.Field(AL0WEEK);
+        archive.Field(AL1MIN);
+        archive.Field(AL1HOUR);
+        archive.Field(AL1DAY);
+        archive.Field(AL1MON);
+        archive.Field(RTCSEC_carry);
+    }
+}
@@ -8,7 +8,9 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
+#include <algorithm>
 #include <vector>
 
 namespace casioemu
@@ -19,8 +21,27 @@ namespace casioemu
 		uint8_t mask, offset;
 	};
 
+	/**
+	 * Spreads the bits of a byte of the screen buffer to every other bit,
+	 * leftmost dot (MSB) first, so that the bits of two buffers can be
+	 * interleaved into 2-bit ink levels.
+	 */
+	struct SpreadBits
+	{
+		uint16_t value[256];
+
+		constexpr SpreadBits() : value()
+		{
+			for (int byte = 0; byte != 256; ++byte)
+				for (int bit = 0; bit != 8; ++bit)
+					if (byte & (0x80 >> bit))
+						value[byte] |= 1 << (2 * bit);
+		}
+	};
+	static constexpr SpreadBits spread_bits;
+
 	template <HardwareId hardware_id>
-	class Screen : public Peripheral
+	class Screen : public ScreenBase
 	{
 		static int const N_ROW, // excluding the 1 row used for status line
 			ROW_SIZE, // bytes
@@ -33,6 +54,40 @@ namespace casioemu
 	    SDL_Renderer *renderer;
 	    SDL_Texture *interface_texture;
 
+		/**
+		 * The dot matrix is rasterized into `lcd_pixels` and uploaded to the
+		 * streaming texture `lcd_texture` once per frame. Each dot is a copy
+		 * of the `rsd_pixel` sprite (`dot_texels`), tinted by the colour of
+		 * its ink level which is looked up in `level_colours`.
+		 */
+		SDL_Texture *lcd_texture;
+		std::vector<uint32_t> lcd_pixels, dot_texels;
+		int lcd_width, lcd_height;
+		std::vector<uint32_t> level_colours[4];
+
+		/**
+		 * The screen buffers of the frame rasterized last. Only the rows that
+		 * differ in the next frame are rasterized and uploaded again, unless
+		 * the ink levels changed (`lcd_level_alpha`, `lcd_clear_dots`).
+		 */
+		std::vector<uint8_t> lcd_buffer, lcd_buffer1;
+		int lcd_level_alpha[4];
+		bool lcd_clear_dots;
+		bool real_hardware;
+
+		void SetupRasterizer();
+		void RasterizeRow(const LCDFrame &frame, int iy, bool clear_dots);
+		bool RowChanged(const LCDFrame &frame, int iy);
+
+		void MarkDirty(uint8_t *buffer, size_t offset, uint8_t data)
+		{
+			if (buffer[offset] == data)
+				return;
+			buffer[offset] = data;
+			// * Set require_frame to true only if the value changed.
+			require_frame = true;
+		}
+
 		enum Sprite : unsigned {
 		};
 
@@ -86,11 +141,15 @@ namespace casioemu
 		}
 
 	public:
-		using Peripheral::Peripheral;
+		using ScreenBase::ScreenBase;
 
 		void Initialise();
 		void Uninitialise();
 		void Frame();
+		bool PublishFrame();
+		void SerializeState(StateArchive &archive);
+		void GetDotMatrixSize(int &width, int &height);
+		void ReadDotMatrix(const LCDFrame &frame, uint8_t *dots);
 	};
 
 	template <> const int Screen<HW_CLASSWIZ_II>::N_ROW = 63;
@@ -275,7 +334,15 @@ namespace casioemu
 		ink_colour = emulator.GetModelInfo("ink_colour");
 		require_frame = true;
 
-		screen_buffer = new uint8_t[(N_ROW + 1) * ROW_SIZE];
+		// * Read once here, `Frame` runs without access to the Lua state.
+		real_hardware = emulator.GetModelInfo("real_hardware");
+
+		// * Headless emulators have no renderer, the LCD is only the screen buffers.
+		lcd_texture = nullptr;
+		if (!emulator.headless)
+			SetupRasterizer();
+
+		screen_buffer = new uint8_t[(N_ROW + 1) * ROW_SIZE]();
 
 		if (emulator.hardware_id != HW_CLASSWIZ_II) {
 			region_buffer.Setup(0xF800, (N_ROW + 1) * ROW_SIZE, "Screen/Buffer", this, [](MMURegion *region, size_t offset) {
@@ -289,15 +356,13 @@ namespace casioemu
 					return;
 
 				auto this_obj = (Screen *)region->userdata;
-				// * Set require_frame to true only if the value changed.
-				this_obj->require_frame |= this_obj->screen_buffer[offset] != data;
-				this_obj->screen_buffer[offset] = data;
+				this_obj->MarkDirty(this_obj->screen_buffer, offset, data);
 			}, emulator);
 		} else {
-			screen_buffer1 = new uint8_t[(N_ROW + 1) * ROW_SIZE];
+			screen_buffer1 = new uint8_t[(N_ROW + 1) * ROW_SIZE]();
 			region_select.Setup(0xF037, 1, "Screen/Select", this, DefaultRead<uint8_t, 0x04, &Screen::screen_select>,
 				SetRequireFrameWrite<uint8_t, 0x04, &Screen::screen_select>, emulator);
-			if(!emulator.GetModelInfo("real_hardware")) {
+			if(!real_hardware) {
 				region_buffer.Setup(0xF800, (N_ROW + 1) * ROW_SIZE, "Screen/Buffer", this, [](MMURegion *region, size_t offset) {
 					offset -= region->base;
 					if (offset % ROW_SIZE >= ROW_SIZE_DISP)
@@ -309,9 +374,7 @@ namespace casioemu
 						return;
 
 					auto this_obj = (Screen *)region->userdata;
-					// * Set require_frame to true only if the value changed.
-					this_obj->require_frame |= this_obj->screen_buffer[offset] != data;
-					this_obj->screen_buffer[offset] = data;
+					this_obj->MarkDirty(this_obj->screen_buffer, offset, data);
 				}, emulator);
 				region_buffer1.Setup(0x89000, (N_ROW + 1) * ROW_SIZE, "Screen/Buffer1", this, [](MMURegion* region, size_t offset) {
 					offset -= region->base;
@@ -324,9 +387,7 @@ namespace casioemu
 						return;
 
 					auto this_obj = (Screen*)region->userdata;
-					// * Set require_frame to true only if the value changed.
-					this_obj->require_frame |= this_obj->screen_buffer1[offset] != data;
-					this_obj->screen_buffer1[offset] = data;
+					this_obj->MarkDirty(this_obj->screen_buffer1, offset, data);
 				}, emulator);
 			} else {
 				region_buffer.Setup(0xF800, (N_ROW + 1) * ROW_SIZE, "Screen/Buffer", this, [](MMURegion *region, size_t offset) {
@@ -344,13 +405,10 @@ namespace casioemu
 						return;
 
 					auto this_obj = (Screen *)region->userdata;
-					// * Set require_frame to true only if the value changed.
 					if(((Screen *)region->userdata)->screen_select & 0x04) {
-						this_obj->require_frame |= this_obj->screen_buffer1[offset] != data;
-						this_obj->screen_buffer1[offset] = data;
+						this_obj->MarkDirty(this_obj->screen_buffer1, offset, data);
 					} else {
-						this_obj->require_frame |= this_obj->screen_buffer[offset] != data;
-						this_obj->screen_buffer[offset] = data;
+						this_obj->MarkDirty(this_obj->screen_buffer, offset, data);
 					}
 				}, emulator);
 			}
@@ -364,6 +422,33 @@ namespace casioemu
 
 		region_contrast.Setup(0xF032, 1, "Screen/Contrast", this, DefaultRead<uint8_t, 0x3F, &Screen::screen_contrast>,
 				SetRequireFrameWrite<uint8_t, 0x3F, &Screen::screen_contrast>, emulator);
+
+		screen_contrast = screen_mode = 0;
+		PublishFrame();
+	}
+
+	template<HardwareId hardware_id> void Screen<hardware_id>::SetupRasterizer()
+	{
+		SDL_Rect pixel_src = sprite_info[Sprite::SPR_PIXEL].src;
+		SDL_Surface *interface_surface = emulator.GetInterfaceSurface();
+		SDL_LockSurface(interface_surface);
+		for (int iy = 0; iy != pixel_src.h; ++iy)
+			for (int ix = 0; ix != pixel_src.w; ++ix)
+				dot_texels.push_back(((uint32_t *)((uint8_t *)interface_surface->pixels + (pixel_src.y + iy) * interface_surface->pitch))[pixel_src.x + ix]);
+		SDL_UnlockSurface(interface_surface);
+		for (auto &colours : level_colours)
+			colours.resize(dot_texels.size());
+
+		lcd_width = ROW_SIZE_DISP * 8 * pixel_src.w;
+		lcd_height = N_ROW * pixel_src.h;
+		lcd_pixels.resize(lcd_width * lcd_height);
+		lcd_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, lcd_width, lcd_height);
+		if (!lcd_texture)
+			PANIC("SDL_CreateTexture failed: %s\n", SDL_GetError());
+		SDL_SetTextureBlendMode(lcd_texture, SDL_BLENDMODE_BLEND);
+		for (int &alpha : lcd_level_alpha)
+			alpha = -1;
+		lcd_clear_dots = false;
 	}
 
 	template<HardwareId hardware_id> void Screen<hardware_id>::Uninitialise()
@@ -371,22 +456,81 @@ namespace casioemu
 		delete[] screen_buffer;
 		if(emulator.hardware_id == HW_CLASSWIZ_II)
 			delete[] screen_buffer1;
+		if (lcd_texture)
+			SDL_DestroyTexture(lcd_texture);
 	}
 
-	template<HardwareId hardware_id> void Screen<hardware_id>::Frame()
+	template<HardwareId hardware_id> bool Screen<hardware_id>::RowChanged(const LCDFrame &frame, int iy)
+	{
+		if (lcd_buffer.empty())
+			return true;
+		size_t row = iy * ROW_SIZE + OFFSET;
+		if (!std::equal(frame.buffer.begin() + row, frame.buffer.begin() + row + ROW_SIZE_DISP, lcd_buffer.begin() + row))
+			return true;
+		return hardware_id == HW_CLASSWIZ_II && !std::equal(frame.buffer1.begin() + row, frame.buffer1.begin() + row + ROW_SIZE_DISP, lcd_buffer1.begin() + row);
+	}
+
+	template<HardwareId hardware_id> void Screen<hardware_id>::RasterizeRow(const LCDFrame &frame, int iy, bool clear_dots)
+	{
+		int dot_w = sprite_info[Sprite::SPR_PIXEL].src.w, dot_h = sprite_info[Sprite::SPR_PIXEL].src.h;
+		uint32_t *row = lcd_pixels.data() + iy * dot_h * lcd_width;
+		for (int ix = 0; ix != ROW_SIZE_DISP; ++ix)
+		{
+			uint16_t levels = 0;
+			if (!clear_dots)
+			{
+				levels = spread_bits.value[frame.buffer[iy * ROW_SIZE + OFFSET + ix]];
+				if (hardware_id == HW_CLASSWIZ_II)
+					levels |= spread_bits.value[frame.buffer1[iy * ROW_SIZE + OFFSET + ix]] << 1;
+			}
+
+			uint32_t *dot = row + ix * 8 * dot_w;
+			for (int bit = 0; bit != 8; ++bit, dot += dot_w, levels >>= 2)
+			{
+				const uint32_t *colours = level_colours[levels & 3].data();
+				for (int ty = 0; ty != dot_h; ++ty)
+					for (int tx = 0; tx != dot_w; ++tx)
+						dot[ty * lcd_width + tx] = *colours++;
+			}
+		}
+	}
+
+	template<HardwareId hardware_id> bool Screen<hardware_id>::PublishFrame()
 	{
+		if (!require_frame)
+			return false;
 		require_frame = false;
 
-		int ink_alpha_on = 20 + screen_contrast * 16;
+		LCDFrame &frame = frames.Back();
+		frame.buffer.assign(screen_buffer, screen_buffer + (N_ROW + 1) * ROW_SIZE);
+		if (hardware_id == HW_CLASSWIZ_II)
+			frame.buffer1.assign(screen_buffer1, screen_buffer1 + (N_ROW + 1) * ROW_SIZE);
+		frame.contrast = screen_contrast;
+		frame.mode = screen_mode;
+		frame.cycle = emulator.cycle_count;
+		frames.Publish();
+		return true;
+	}
+
+	/**
+	 * Draws the frame published last. Runs on the renderer's thread while
+	 * the machine keeps running, so it must not touch anything but the frame
+	 * and the rasterizer.
+	 */
+	template<HardwareId hardware_id> void Screen<hardware_id>::Frame()
+	{
+		const LCDFrame &frame = LatestFrame();
+
+		int ink_alpha_on = 20 + frame.contrast * 16;
 		if (ink_alpha_on > 255)
 			ink_alpha_on = 255;
-		int ink_alpha_off = (screen_contrast - 8) * 2;
+		int ink_alpha_off = (frame.contrast - 8) * 2;
 		if (ink_alpha_off < 0)
 			ink_alpha_off = 0;
 
 		bool enable_status, enable_dotmatrix, clear_dots;
 
-		switch (screen_mode)
+		switch (frame.mode)
 		{
 		case 4:
 			enable_dotmatrix = true;
@@ -417,13 +561,13 @@ namespace casioemu
 		if (enable_status)
 		{
 			int ink_alpha = ink_alpha_off;
-			if(emulator.hardware_id == HW_CLASSWIZ_II && emulator.GetModelInfo("real_hardware")) {
+			if(emulator.hardware_id == HW_CLASSWIZ_II && real_hardware) {
 				for (int ix = Sprite::SPR_PIXEL + 1; ix != Sprite::SPR_MAX; ++ix)
 				{
 					ink_alpha = ink_alpha_off;
-					if (screen_buffer[sprite_bitmap[ix].offset] & sprite_bitmap[ix].mask)
+					if (frame.buffer[sprite_bitmap[ix].offset] & sprite_bitmap[ix].mask)
 						ink_alpha += (ink_alpha_on - ink_alpha_off) * 0.333;
-					if (screen_buffer1[sprite_bitmap[ix].offset] & sprite_bitmap[ix].mask)
+					if (frame.buffer1[sprite_bitmap[ix].offset] & sprite_bitmap[ix].mask)
 						ink_alpha += (ink_alpha_on - ink_alpha_off) * 0.667;
 					SDL_SetTextureAlphaMod(interface_texture, ink_alpha);
 					SDL_RenderCopy(renderer, interface_texture, &sprite_info[ix].src, &sprite_info[ix].dest);
@@ -431,7 +575,7 @@ namespace casioemu
 			} else {
 				for (int ix = Sprite::SPR_PIXEL + 1; ix != Sprite::SPR_MAX; ++ix)
 				{
-					if (screen_buffer[sprite_bitmap[ix].offset] & sprite_bitmap[ix].mask)
+					if (frame.buffer[sprite_bitmap[ix].offset] & sprite_bitmap[ix].mask)
 						SDL_SetTextureAlphaMod(interface_texture, ink_alpha_on);
 					else
 						SDL_SetTextureAlphaMod(interface_texture, ink_alpha_off);
@@ -442,51 +586,110 @@ namespace casioemu
 
 		if (enable_dotmatrix)
 		{
-			static constexpr auto SPR_PIXEL = Sprite::SPR_PIXEL;
-			SDL_Rect dest = Screen<hardware_id>::sprite_info[SPR_PIXEL].dest;
-			int ink_alpha = ink_alpha_off;
-			if (emulator.hardware_id == HW_CLASSWIZ_II) {
-				for (int iy = 0; iy != N_ROW; ++iy)
+			// * Ink levels: bit 0 is set by `screen_buffer`, bit 1 by `screen_buffer1`
+			// * (CWII only, which blends the two planes to grey).
+			int level_alpha[4];
+			for (int level = 0; level != 4; ++level)
+			{
+				int ink_alpha = ink_alpha_off;
+				if (hardware_id != HW_CLASSWIZ_II)
 				{
-					dest.x = sprite_info[SPR_PIXEL].dest.x;
-					dest.y = sprite_info[SPR_PIXEL].dest.y + iy * sprite_info[SPR_PIXEL].src.h;
-					for (int ix = 0; ix != ROW_SIZE_DISP; ++ix)
-					{
-						for (uint8_t mask = 0x80; mask; mask >>= 1, dest.x += sprite_info[SPR_PIXEL].src.w)
-						{
-							ink_alpha = ink_alpha_off;
-							if (!clear_dots && screen_buffer[iy * ROW_SIZE + OFFSET + ix] & mask)
-								ink_alpha += (ink_alpha_on - ink_alpha_off) * 0.333;
-							if (!clear_dots && screen_buffer1[iy * ROW_SIZE + OFFSET + ix] & mask)
-								ink_alpha += (ink_alpha_on - ink_alpha_off) * 0.667;
-							SDL_SetTextureAlphaMod(interface_texture, ink_alpha);
-							SDL_RenderCopy(renderer, interface_texture, &sprite_info[SPR_PIXEL].src, &dest);
-						}
-					}
+					if (level & 1)
+						ink_alpha = ink_alpha_on;
 				}
-			}
-			else {
-				for (int iy = 0; iy != N_ROW; ++iy)
+				else
 				{
-					dest.x = sprite_info[SPR_PIXEL].dest.x;
-					dest.y = sprite_info[SPR_PIXEL].dest.y + iy * sprite_info[SPR_PIXEL].src.h;
-					for (int ix = 0; ix != ROW_SIZE_DISP; ++ix)
+					if (level & 1)
+						ink_alpha += (ink_alpha_on - ink_alpha_off) * 0.333;
+					if (level & 2)
+						ink_alpha += (ink_alpha_on - ink_alpha_off) * 0.667;
+				}
+				level_alpha[level] = ink_alpha;
+			}
+
+			bool all_rows = false;
+			if (clear_dots != lcd_clear_dots || !std::equal(level_alpha, level_alpha + 4, lcd_level_alpha))
+			{
+				lcd_clear_dots = clear_dots;
+				std::copy(level_alpha, level_alpha + 4, lcd_level_alpha);
+				all_rows = true;
+
+				// * Same as SDL's colour and alpha modulation of the sprite.
+				for (int level = 0; level != 4; ++level)
+					for (size_t ix = 0; ix != dot_texels.size(); ++ix)
 					{
-						for (uint8_t mask = 0x80; mask; mask >>= 1, dest.x += sprite_info[SPR_PIXEL].src.w)
-						{
-							if (!clear_dots && screen_buffer[iy * ROW_SIZE + OFFSET + ix] & mask)
-								SDL_SetTextureAlphaMod(interface_texture, ink_alpha_on);
-							else
-								SDL_SetTextureAlphaMod(interface_texture, ink_alpha_off);
-							SDL_RenderCopy(renderer, interface_texture, &sprite_info[SPR_PIXEL].src, &dest);
-						}
+						uint32_t texel = dot_texels[ix];
+						level_colours[level][ix] =
+							((texel >> 24) * level_alpha[level] / 255) << 24 |
+							((texel >> 16 & 0xFF) * ink_colour.r / 255) << 16 |
+							((texel >> 8 & 0xFF) * ink_colour.g / 255) << 8 |
+							((texel & 0xFF) * ink_colour.b / 255);
 					}
-				}
 			}
+
+			int first_row = -1, last_row = -1;
+			for (int iy = 0; iy != N_ROW; ++iy)
+			{
+				if (!all_rows && !RowChanged(frame, iy))
+					continue;
+				RasterizeRow(frame, iy, clear_dots);
+				if (first_row == -1)
+					first_row = iy;
+				last_row = iy;
+			}
+
+			if (first_row != -1)
+			{
+				int dot_h = sprite_info[Sprite::SPR_PIXEL].src.h;
+				SDL_Rect rect{0, first_row * dot_h, lcd_width, (last_row - first_row + 1) * dot_h};
+				SDL_UpdateTexture(lcd_texture, &rect, lcd_pixels.data() + rect.y * lcd_width, lcd_width * sizeof(uint32_t));
+			}
+			lcd_buffer = frame.buffer;
+			lcd_buffer1 = frame.buffer1;
+
+			SDL_Rect dest = sprite_info[Sprite::SPR_PIXEL].dest;
+			dest.w = lcd_width;
+			dest.h = lcd_height;
+			SDL_RenderCopy(renderer, lcd_texture, nullptr, &dest);
 		}
 	}
 
-	Peripheral *CreateScreen(Emulator& emulator)
+	template<HardwareId hardware_id> void Screen<hardware_id>::SerializeState(StateArchive &archive)
+	{
+		archive.Section("Screen");
+		Peripheral::SerializeState(archive);
+		archive.Bytes(screen_buffer, (N_ROW + 1) * ROW_SIZE);
+		if (hardware_id == HW_CLASSWIZ_II)
+			archive.Bytes(screen_buffer1, (N_ROW + 1) * ROW_SIZE);
+		archive.Field(screen_contrast);
+		archive.Field(screen_mode);
+		archive.Field(screen_range);
+		archive.Field(screen_select);
+
+		if (archive.Loading())
+			require_frame = true;
+	}
+
+	template<HardwareId hardware_id> void Screen<hardware_id>::GetDotMatrixSize(int &width, int &height)
+	{
+		width = ROW_SIZE_DISP * 8;
+		height = N_ROW;
+	}
+
+	template<HardwareId hardware_id> void Screen<hardware_id>::ReadDotMatrix(const LCDFrame &frame, uint8_t *dots)
+	{
+		for (int iy = 0; iy != N_ROW; ++iy)
+			for (int ix = 0; ix != ROW_SIZE_DISP; ++ix)
+			{
+				uint16_t levels = spread_bits.value[frame.buffer[iy * ROW_SIZE + OFFSET + ix]];
+				if (hardware_id == HW_CLASSWIZ_II)
+					levels |= spread_bits.value[frame.buffer1[iy * ROW_SIZE + OFFSET + ix]] << 1;
+				for (int bit = 0; bit != 8; ++bit, levels >>= 2)
+					*dots++ = levels & 3;
+			}
+	}
+
+	ScreenBase *CreateScreen(Emulator& emulator)
 	{
 		switch (emulator.hardware_id)
 		{
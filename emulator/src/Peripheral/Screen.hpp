@@ -2,9 +2,74 @@
 #include "../Config.hpp"
 
 #include "Peripheral.hpp"
+#include "../Data/TripleBuffer.hpp"
+
+#include <vector>
 
 namespace casioemu
 {
-	Peripheral *CreateScreen(Emulator& emulator);
-}
+	/**
+	 * A completed frame of the LCD: everything that's drawn, as it was when
+	 * the screen published it.
+	 */
+	struct LCDFrame
+	{
+		// * Screen buffers including the status line; `buffer1` is the second plane (ClassWiz II only).
+		std::vector<uint8_t> buffer, buffer1;
+		uint8_t contrast, mode;
+		// * Value of `Emulator::cycle_count` when the frame was published.
+		Uint64 cycle;
+	};
+
+	/**
+	 * The part of the screen peripheral that's used outside of it, e.g. to
+	 * read the LCD of a headless emulator.
+	 */
+	class ScreenBase : public Peripheral
+	{
+	protected:
+		TripleBuffer<LCDFrame> frames;
+
+	public:
+		using Peripheral::Peripheral;
 
+		/**
+		 * Publishes the current content of the LCD if it changed since the
+		 * last frame, and returns whether it did. Called by the emulation
+		 * thread at the end of `Emulator::RunCycles`.
+		 */
+		virtual bool PublishFrame() = 0;
+		/**
+		 * The frame published last. Can be called from another thread than
+		 * the one that owns the machine, but only from one: `Frame` calls it
+		 * on the renderer's thread, headless emulators leave it to whoever
+		 * reads their LCD.
+		 */
+		LCDFrame &LatestFrame()
+		{
+			frames.Update();
+			return frames.Front();
+		}
+		/**
+		 * The frame published last, for the emulation thread.
+		 */
+		const LCDFrame &PublishedFrame()
+		{
+			return frames.Published();
+		}
+
+		/**
+		 * Size of the dot matrix in dots, excluding the status line.
+		 */
+		virtual void GetDotMatrixSize(int &width, int &height) = 0;
+		/**
+		 * Writes the ink level of every dot of the dot matrix of `frame` to
+		 * `dots`, row by row: 0 or 1, on ClassWiz II 0 to 3 (bit 0 from the
+		 * first plane, bit 1 from the second one). This is the content of the
+		 * screen buffers regardless of the display mode.
+		 */
+		virtual void ReadDotMatrix(const LCDFrame &frame, uint8_t *dots) = 0;
+	};
+
+	ScreenBase *CreateScreen(Emulator& emulator);
+}
@@ -4,6 +4,7 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 namespace casioemu
 {
@@ -56,4 +57,14 @@ namespace casioemu
 		stop_acceptor_enabled = false;
 		shutdown_acceptor_enabled = false;
 	}
+
+	void StandbyControl::SerializeState(StateArchive &archive)
+	{
+		archive.Section("StandbyControl");
+		Peripheral::SerializeState(archive);
+		archive.Field(stpacp_last);
+		archive.Field(F312_last);
+		archive.Field(stop_acceptor_enabled);
+		archive.Field(shutdown_acceptor_enabled);
+	}
 }
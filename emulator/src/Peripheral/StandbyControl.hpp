@@ -17,6 +17,7 @@ namespace casioemu
 
 		void Initialise();
 		void Reset();
+		void SerializeState(StateArchive &archive);
 	};
 }
 
@@ -4,6 +4,7 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 #include <cmath>
 
@@ -114,6 +115,44 @@ namespace casioemu
 		}
 	}
 
+	size_t Timer::GetIdleTicks()
+	{
+		if(!real_hardware) {
+			if(raise_required || ext_to_int_counter == ext_to_int_next)
+				return 0;
+			return ext_to_int_counter < ext_to_int_next ? ext_to_int_next - ext_to_int_counter : idle_forever;
+		}
+
+		if(!data_control)
+			return idle_forever;
+
+		uint64_t first_division = ext_to_int_counter < TimerFreqDiv ? TimerFreqDiv - ext_to_int_counter : 1;
+		if(!data_interval)
+			return first_division - 1;
+		uint64_t divisions = data_counter < data_interval ? data_interval - data_counter : 1;
+		return first_division - 1 + (divisions - 1) * TimerFreqDiv;
+	}
+
+	void Timer::SkipTicks(size_t ticks)
+	{
+		if(!real_hardware) {
+			ext_to_int_counter += ticks;
+			return;
+		}
+
+		if(!data_control)
+			return;
+
+		uint64_t first_division = ext_to_int_counter < TimerFreqDiv ? TimerFreqDiv - ext_to_int_counter : 1;
+		if(ticks < first_division) {
+			ext_to_int_counter += ticks;
+			return;
+		}
+		ticks -= first_division;
+		ext_to_int_counter = ticks % TimerFreqDiv;
+		data_counter = data_interval ? data_counter + 1 + ticks / TimerFreqDiv : 0;
+	}
+
 	void Timer::TickAfterInterrupts()
 	{
 		if(!real_hardware) {
@@ -166,4 +205,20 @@ namespace casioemu
 		region_F024.Kill();
 		region_control.Kill();
 	}
+
+	void Timer::SerializeState(StateArchive &archive)
+	{
+		archive.Section("Timer");
+		Peripheral::SerializeState(archive);
+		archive.Field(data_counter);
+		archive.Field(data_interval);
+		archive.Field(data_F024);
+		archive.Field(data_control);
+		archive.Field(raise_required);
+		archive.Field(EmuStopped);
+		archive.Field(ext_to_int_counter);
+		archive.Field(ext_to_int_next);
+		archive.Field(ext_to_int_int_done);
+		archive.Field(TimerFreqDiv);
+	}
 }
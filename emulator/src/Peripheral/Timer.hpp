@@ -29,7 +29,10 @@ namespace casioemu
 
 		void Initialise();
 		void Reset();
+		void SerializeState(StateArchive &archive);
 		void Tick();
+		size_t GetIdleTicks();
+		void SkipTicks(size_t ticks);
 		void TickAfterInterrupts();
 		void DivideTicks();
 		void Uninitialise();
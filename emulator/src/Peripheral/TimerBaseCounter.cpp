@@ -3,6 +3,7 @@
 #include "../Logger.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 namespace casioemu
 {
@@ -44,6 +45,17 @@ namespace casioemu
         }
     }
 
+    size_t TimerBaseCounter::GetIdleTicks() {
+        //The tick after an output clears it again.
+        if(LTBR_reset_tick || emulator.chipset.LSCLK_output)
+            return 0;
+        return LTBROutputCount - 1 - LTBRCounter;
+    }
+
+    void TimerBaseCounter::SkipTicks(size_t ticks) {
+        LTBRCounter += ticks;
+    }
+
     void TimerBaseCounter::ResetLSCLK() {
         LTBRCounter = 0;
         emulator.chipset.LSCLK_output = 0xFF;
@@ -54,4 +66,12 @@ namespace casioemu
         emulator.chipset.MaskableInterrupts[L4096SINT].TryRaise();
         emulator.chipset.MaskableInterrupts[L16384SINT].TryRaise();
     }
-}
\ No newline at end of file
+
+    void TimerBaseCounter::SerializeState(StateArchive &archive) {
+        archive.Section("TimerBaseCounter");
+        Peripheral::SerializeState(archive);
+        archive.Field(current_output);
+        archive.Field(LTBR_reset_tick);
+        archive.Field(LTBRCounter);
+    }
+}
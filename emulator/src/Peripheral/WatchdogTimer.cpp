@@ -4,6 +4,7 @@
 #include "../Chipset/MMU.hpp"
 #include "../Emulator.hpp"
 #include "../Chipset/Chipset.hpp"
+#include "../Data/StateArchive.hpp"
 
 #include <cmath>
 
@@ -56,6 +57,10 @@ namespace casioemu
         }
     }
 
+    size_t WatchdogTimer::GetIdleTicks() {
+        return emulator.chipset.HSCLK_output & 0x20 ? 0 : idle_forever;
+    }
+
     void WatchdogTimer::Reset() {
         data_WDTCON = 0;
         data_WDTMOD = 2;
@@ -65,4 +70,14 @@ namespace casioemu
         WDT_counter = 0;
         overflow_count = false;
     }
+
+    void WatchdogTimer::SerializeState(StateArchive &archive) {
+        archive.Section("WatchdogTimer");
+        Peripheral::SerializeState(archive);
+        archive.Field(data_WDTCON);
+        archive.Field(data_WDTMOD);
+        archive.Field(data_WDP);
+        archive.Field(WDT_counter);
+        archive.Field(overflow_count);
+    }
 }
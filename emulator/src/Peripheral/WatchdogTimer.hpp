@@ -21,6 +21,8 @@ namespace casioemu
 
 		void Initialise();
 		void Reset();
+		void SerializeState(StateArchive &archive);
 		void Tick();
+		size_t GetIdleTicks();
 	};
 }
@@ -4,7 +4,7 @@
 
 #include <SDL.h>
 #include <SDL_image.h>
-#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <iostream>
@@ -55,6 +55,11 @@ int main(int argc, char *argv[]) {
         exit(2);
     }
 
+    if (argv_map.find("headless") != argv_map.end()) {
+        printf("Use casioemu_headless for headless mode\n");
+        exit(2);
+    }
+
     int sdlFlags = SDL_INIT_VIDEO | SDL_INIT_TIMER;
     if (SDL_Init(sdlFlags) != 0)
         PANIC("SDL_Init failed: %s\n", SDL_GetError());
@@ -78,28 +83,37 @@ int main(int argc, char *argv[]) {
     // 	;
     {
         Emulator emulator(argv_map);
-        m_emu = &emulator;
 
         // Note: argv_map must be destructed after emulator.
 
-        // Used to signal to the console input thread when to stop.
-        static std::atomic<bool> running(true);
+        // Used to signal to the console input thread when to stop, and to
+        // hand it the lines read by the readline thread. Static, since a
+        // readline thread still waiting for input outlives this scope.
+        static std::mutex console_mx;
+        static std::condition_variable console_cv;
+        static bool running = true, got;
+        static char *console_line;
 
         std::thread console_input_thread([&] {
             while (1) {
                 char *console_input_c_str;
-				bool got = false;
-				std::thread readline_thread([&]{
-					console_input_c_str = readline("> ");
-					got = true;
-				});
-				readline_thread.detach();
-
-				while (!got) {
-					if (!running) {
-						return;
-					}
-				}
+                {
+                    std::unique_lock<std::mutex> console_lock(console_mx);
+                    got = false;
+                    std::thread readline_thread([] {
+                        char *line = readline("> ");
+                        std::lock_guard<std::mutex> line_lock(console_mx);
+                        console_line = line;
+                        got = true;
+                        console_cv.notify_all();
+                    });
+                    readline_thread.detach();
+
+                    console_cv.wait(console_lock, [] { return got || !running; });
+                    if (!got)
+                        return;
+                    console_input_c_str = console_line;
+                }
 
                 if (console_input_c_str == NULL) {
                     if (argv_map.find("exit_on_console_shutdown") != argv_map.end()) {
@@ -121,13 +135,17 @@ int main(int argc, char *argv[]) {
 
                 add_history(console_input_c_str);
 
-                std::lock_guard<decltype(emulator.access_mx)> access_lock(emulator.access_mx);
-                if (!emulator.Running())
-                    break;
-                emulator.ExecuteCommand(console_input_c_str);
+                // The command runs on the emulation thread; the GUI keeps
+                // going while we wait for it.
+                bool still_running = emulator.Submit([&emulator, console_input_c_str] {
+                    if (!emulator.Running())
+                        return false;
+                    emulator.ExecuteCommand(console_input_c_str);
+                    return emulator.Running();
+                }).get();
                 free(console_input_c_str);
 
-                if (!emulator.Running()) {
+                if (!still_running) {
                     SDL_Event event;
                     SDL_zero(event);
                     event.type = SDL_USEREVENT;
@@ -140,10 +158,21 @@ int main(int argc, char *argv[]) {
 
         bool guiCreated = false;
         std::thread t1([&]() {
-            test_gui(&guiCreated);
+            test_gui(emulator, &guiCreated);
+            // Paced at 60 frames per second: vsync may be off, and gui_loop
+            // returns right away once the emulator has stopped.
+            auto frame_end = std::chrono::steady_clock::now();
             while (1) {
                 SDL_Event event;
                 gui_loop();
+
+                frame_end += std::chrono::microseconds(1000000 / 60);
+                auto now = std::chrono::steady_clock::now();
+                if (frame_end > now)
+                    std::this_thread::sleep_until(frame_end);
+                else
+                    frame_end = now;
+
                 if (!SDL_PollEvent(&event))
                     continue;
                 
@@ -168,8 +197,10 @@ int main(int argc, char *argv[]) {
         while (emulator.Running()) {
 
             // std::cout<<SDL_GetMouseFocus()<<","<<emulator.window<<std::endl;
+            // The timeout is only there to notice emulators shut down by a
+            // script, which doesn't post an event.
             SDL_Event event;
-            if (!SDL_PollEvent(&event))
+            if (!SDL_WaitEventTimeout(&event, 100))
                 continue;
 
             switch (event.type) {
@@ -219,12 +250,18 @@ int main(int argc, char *argv[]) {
                     ImGui_ImplSDL2_ProcessEvent(&event);
                     break;
                 }
-                emulator.UIEvent(event);
+                emulator.Post([&emulator, event]() mutable {
+                    emulator.UIEvent(event);
+                });
                 break;
             }
         }
 
-        running = false;
+        {
+            std::lock_guard<std::mutex> console_lock(console_mx);
+            running = false;
+        }
+        console_cv.notify_all();
         console_input_thread.join();
     }
 
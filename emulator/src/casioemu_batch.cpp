@@ -0,0 +1,317 @@
+#include "Config.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <lua.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Emulator.hpp"
+#include "Logger.hpp"
+#include "Chipset/Chipset.hpp"
+#include "Chipset/MMU.hpp"
+#include "Peripheral/BatteryBackedRAM.hpp"
+#include "Peripheral/Keyboard.hpp"
+#include "Peripheral/Screen.hpp"
+
+using namespace casioemu;
+
+/**
+ * One entry of the manifest. Times are in milliseconds of emulated time.
+ */
+struct TestCase {
+    std::string name, model, state, replay, ram, keys, lcd, save_lcd;
+    int press_time, delay_time, settle_time;
+    // Expected bytes of data memory, by address.
+    std::map<size_t, std::string> memory;
+};
+
+struct TestResult {
+    bool passed;
+    std::string message;
+    uint64_t cycles;
+    double seconds;
+};
+
+/**
+ * Cases are dealt round-robin to one queue per worker. A worker takes cases
+ * from the front of its own queue and, once that's empty, steals from the back
+ * of the others, so a few long cases don't leave the other workers idle.
+ */
+class WorkStealingQueues {
+    struct Queue {
+        std::mutex mx;
+        std::deque<size_t> jobs;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+
+public:
+    WorkStealingQueues(size_t workers, size_t jobs) {
+        for (size_t ix = 0; ix != workers; ++ix)
+            queues.emplace_back(new Queue);
+        for (size_t jx = 0; jx != jobs; ++jx)
+            queues[jx % workers]->jobs.push_back(jx);
+    }
+
+    bool Take(size_t worker, size_t &job) {
+        for (size_t ix = 0; ix != queues.size(); ++ix) {
+            Queue &queue = *queues[(worker + ix) % queues.size()];
+            std::lock_guard<std::mutex> queue_lock(queue.mx);
+            if (queue.jobs.empty())
+                continue;
+            if (ix == 0) {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+            } else {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+};
+
+static std::string GetStringField(lua_State *lua_state, const char *key, const std::string &fallback = "") {
+    lua_getfield(lua_state, -1, key);
+    std::string value = lua_isstring(lua_state, -1) ? lua_tostring(lua_state, -1) : fallback;
+    lua_pop(lua_state, 1);
+    return value;
+}
+
+static int GetIntegerField(lua_State *lua_state, const char *key, int fallback) {
+    lua_getfield(lua_state, -1, key);
+    int value = lua_isinteger(lua_state, -1) ? (int)lua_tointeger(lua_state, -1) : fallback;
+    lua_pop(lua_state, 1);
+    return value;
+}
+
+/**
+ * The manifest is a Lua file returning an array of cases, see README.md.
+ */
+static std::vector<TestCase> LoadManifest(const char *path) {
+    lua_State *lua_state = luaL_newstate();
+    luaL_openlibs(lua_state);
+    if (luaL_dofile(lua_state, path) != LUA_OK)
+        PANIC("failed to load manifest: %s\n", lua_tostring(lua_state, -1));
+    if (!lua_istable(lua_state, -1))
+        PANIC("manifest must return a table of cases\n");
+
+    std::vector<TestCase> cases;
+    lua_Integer case_count = luaL_len(lua_state, -1);
+    for (lua_Integer ix = 1; ix <= case_count; ++ix) {
+        lua_geti(lua_state, -1, ix);
+        if (!lua_istable(lua_state, -1))
+            PANIC("manifest case #%lld is not a table\n", (long long)ix);
+
+        TestCase test_case;
+        test_case.name = GetStringField(lua_state, "name", "#" + std::to_string(ix));
+        test_case.model = GetStringField(lua_state, "model");
+        if (test_case.model.empty())
+            PANIC("manifest case %s has no model\n", test_case.name.c_str());
+        test_case.state = GetStringField(lua_state, "state");
+        test_case.replay = GetStringField(lua_state, "replay");
+        test_case.ram = GetStringField(lua_state, "ram");
+        test_case.keys = GetStringField(lua_state, "keys");
+        test_case.lcd = GetStringField(lua_state, "lcd");
+        test_case.save_lcd = GetStringField(lua_state, "save_lcd");
+        test_case.press_time = GetIntegerField(lua_state, "press", 100);
+        test_case.delay_time = GetIntegerField(lua_state, "delay", 150);
+        test_case.settle_time = GetIntegerField(lua_state, "settle", 1000);
+
+        lua_getfield(lua_state, -1, "memory");
+        if (lua_istable(lua_state, -1)) {
+            lua_pushnil(lua_state);
+            while (lua_next(lua_state, -2)) {
+                if (!lua_isinteger(lua_state, -2) || lua_type(lua_state, -1) != LUA_TSTRING)
+                    PANIC("manifest case %s: memory must map addresses to strings\n", test_case.name.c_str());
+                size_t length;
+                const char *bytes = lua_tolstring(lua_state, -1, &length);
+                test_case.memory[lua_tointeger(lua_state, -2)] = std::string(bytes, length);
+                lua_pop(lua_state, 1);
+            }
+        }
+        lua_pop(lua_state, 2);
+
+        cases.push_back(test_case);
+    }
+
+    lua_close(lua_state);
+    return cases;
+}
+
+/**
+ * Runs `cycles` cycles, returns false if the emulator stopped on the way.
+ */
+static bool RunFor(Emulator &emulator, uint64_t cycles, TestResult &result) {
+    uint64_t emulated = emulator.RunCycles(cycles);
+    result.cycles += emulated;
+    if (emulated == cycles && emulator.Running())
+        return true;
+
+    result.message = emulator.Running() ? "emulator paused" : "emulator shut down";
+    return false;
+}
+
+static void CheckCase(Emulator &emulator, const TestCase &test_case, TestResult &result) {
+    ScreenBase &screen = *emulator.chipset.screen;
+    int width, height;
+    screen.GetDotMatrixSize(width, height);
+    std::vector<uint8_t> dots(width * height);
+    screen.ReadDotMatrix(screen.LatestFrame(), dots.data());
+
+    if (!test_case.save_lcd.empty()) {
+        std::ofstream lcd_handle(test_case.save_lcd, std::ofstream::binary);
+        lcd_handle.write((const char *)dots.data(), dots.size());
+        if (lcd_handle.fail()) {
+            result.message = "failed to write " + test_case.save_lcd;
+            return;
+        }
+    }
+
+    if (!test_case.lcd.empty()) {
+        std::ifstream lcd_handle(test_case.lcd, std::ifstream::binary);
+        if (lcd_handle.fail()) {
+            result.message = "failed to read " + test_case.lcd;
+            return;
+        }
+        std::vector<uint8_t> expected((std::istreambuf_iterator<char>(lcd_handle)), std::istreambuf_iterator<char>());
+        if (expected != dots) {
+            result.message = "LCD differs from " + test_case.lcd;
+            return;
+        }
+    }
+
+    for (auto &check : test_case.memory) {
+        for (size_t ix = 0; ix != check.second.size(); ++ix) {
+            uint8_t actual = emulator.chipset.mmu.ReadData(check.first + ix, false);
+            if (actual != (uint8_t)check.second[ix]) {
+                char message[80];
+                std::snprintf(message, sizeof(message), "memory at %06zX is %02X, expected %02X",
+                        check.first + ix, actual, (uint8_t)check.second[ix]);
+                result.message = message;
+                return;
+            }
+        }
+    }
+
+    result.passed = true;
+}
+
+static TestResult RunCase(const TestCase &test_case) {
+    TestResult result{false, "", 0, 0};
+    auto start = std::chrono::steady_clock::now();
+
+    // Note: argv_map must be destructed after emulator.
+    std::map<std::string, std::string> argv_map;
+    argv_map["model"] = test_case.model;
+    argv_map["headless"] = "";
+    argv_map["external_clock"] = "";
+    {
+        Emulator emulator(argv_map);
+        uint64_t cycles_per_ms = emulator.GetCyclesPerSecond() / 1000;
+
+        bool ok = true;
+        if (!test_case.state.empty() && !emulator.LoadStateFile(test_case.state)) {
+            result.message = "failed to load " + test_case.state;
+            ok = false;
+        }
+
+        if (ok && !test_case.replay.empty() && !emulator.StartReplay(test_case.replay)) {
+            result.message = "failed to load " + test_case.replay;
+            ok = false;
+        }
+
+        if (ok && !test_case.ram.empty() && !emulator.chipset.battery_backed_ram->LoadRAMImage(test_case.ram)) {
+            result.message = "failed to load " + test_case.ram;
+            ok = false;
+        }
+
+        Keyboard &keyboard = *emulator.chipset.keyboard;
+        if (ok && !test_case.keys.empty() && !keyboard.StartInject(test_case.keys, test_case.press_time, test_case.delay_time)) {
+            result.message = "failed to load " + test_case.keys;
+            ok = false;
+        }
+
+        // Keys are injected on emulated time, so just run until the sequence and the journal are done.
+        while (ok && (keyboard.isInjectorTriggered || emulator.Replaying()))
+            ok = RunFor(emulator, 100 * cycles_per_ms, result);
+
+        if (ok)
+            ok = RunFor(emulator, test_case.settle_time * cycles_per_ms, result);
+
+        if (ok)
+            CheckCase(emulator, test_case, result);
+
+        emulator.Shutdown();
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+/**
+ * Entry point of the batch runner. Runs every case of a manifest in its own
+ * headless emulator, several at a time, and reports which ones fail their
+ * LCD or memory checks. Exits with 1 if any case failed.
+ */
+int main(int argc, char *argv[]) {
+    const char *manifest_path = nullptr;
+    size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    for (int ix = 1; ix != argc; ++ix) {
+        if (!strncmp(argv[ix], "threads=", 8))
+            thread_count = std::max(std::stoul(argv[ix] + 8), 1ul);
+        else
+            manifest_path = argv[ix];
+    }
+
+    if (!manifest_path) {
+        printf("Usage: casioemu_batch <manifest.lua> [threads=N]\n");
+        exit(2);
+    }
+
+    std::vector<TestCase> cases = LoadManifest(manifest_path);
+    std::vector<TestResult> results(cases.size());
+    thread_count = std::min(thread_count, std::max<size_t>(cases.size(), 1));
+
+    WorkStealingQueues queues(thread_count, cases.size());
+    std::mutex report_mx;
+    std::vector<std::thread> workers;
+    for (size_t wx = 0; wx != thread_count; ++wx) {
+        workers.emplace_back([&, wx] {
+            size_t job;
+            while (queues.Take(wx, job)) {
+                results[job] = RunCase(cases[job]);
+
+                std::lock_guard<std::mutex> report_lock(report_mx);
+                const TestResult &result = results[job];
+                std::cout << (result.passed ? "PASS " : "FAIL ") << cases[job].name;
+                if (!result.passed)
+                    std::cout << ": " << result.message;
+                std::cout << " (" << result.cycles << " cycles, " << result.seconds << " s)" << std::endl;
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    size_t failed = std::count_if(results.begin(), results.end(), [](const TestResult &result) {
+        return !result.passed;
+    });
+    std::cout << "\n" << cases.size() - failed << "/" << cases.size() << " passed" << std::endl;
+    for (size_t ix = 0; ix != cases.size(); ++ix)
+        if (!results[ix].passed)
+            std::cout << "  failed: " << cases[ix].name << std::endl;
+
+    return failed ? 1 : 0;
+}
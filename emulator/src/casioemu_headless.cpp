@@ -0,0 +1,56 @@
+#include "Config.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "Emulator.hpp"
+#include "Logger.hpp"
+
+using namespace casioemu;
+
+/**
+ * Entry point of the headless build. Takes the same arguments as casioemu,
+ * but creates no window and starts neither the debugger nor the console;
+ * the emulator is driven by the scripts passed with `script=` and runs until
+ * one of them calls `emu:shutdown()`.
+ */
+int main(int argc, char *argv[]) {
+    std::map<std::string, std::string> argv_map;
+    for (int ix = 1; ix != argc; ++ix) {
+        std::string key, value;
+        char *eq_pos = strchr(argv[ix], '=');
+        if (eq_pos) {
+            key = std::string(argv[ix], eq_pos);
+            value = eq_pos + 1;
+        } else {
+            key = "model";
+            value = argv[ix];
+        }
+
+        if (argv_map.find(key) == argv_map.end())
+            argv_map[key] = value;
+        else
+            logger::Info("[argv] #%i: key '%s' already set\n", ix, key.c_str());
+    }
+
+    if (argv_map.find("model") == argv_map.end()) {
+        printf("No model path supplied\n");
+        exit(2);
+    }
+    argv_map["headless"] = "";
+
+    {
+        // Note: argv_map must be destructed after emulator.
+        Emulator emulator(argv_map);
+
+        while (emulator.Running())
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    std::cout << "\nGoodbye" << std::endl;
+    return 0;
+}
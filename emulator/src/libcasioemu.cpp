@@ -0,0 +1,197 @@
+#include "libcasioemu.h"
+
+#include "Emulator.hpp"
+#include "Chipset/Chipset.hpp"
+#include "Chipset/MMU.hpp"
+#include "Peripheral/Screen.hpp"
+#include "Peripheral/Keyboard.hpp"
+#include "Peripheral/BatteryBackedRAM.hpp"
+
+#include <cstring>
+#include <map>
+#include <string>
+
+using namespace casioemu;
+
+struct casioemu_instance
+{
+	// * Must outlive `emulator`, which keeps a reference to it.
+	std::map<std::string, std::string> argv_map;
+	Emulator *emulator;
+};
+
+extern "C"
+{
+	casioemu_t *casioemu_create(const char *model_dir, int argc, const char *const *args)
+	{
+		casioemu_t *emu = new casioemu_t;
+		for (int ix = 0; ix != argc; ++ix)
+		{
+			const char *eq_pos = std::strchr(args[ix], '=');
+			if (eq_pos)
+				emu->argv_map[std::string(args[ix], eq_pos)] = eq_pos + 1;
+			else
+				emu->argv_map[args[ix]] = "";
+		}
+		emu->argv_map["model"] = model_dir;
+		emu->argv_map["headless"] = "";
+		emu->argv_map["external_clock"] = "";
+
+		emu->emulator = new Emulator(emu->argv_map);
+		return emu;
+	}
+
+	void casioemu_destroy(casioemu_t *emu)
+	{
+		emu->emulator->Shutdown();
+		delete emu->emulator;
+		delete emu;
+	}
+
+	uint64_t casioemu_run(casioemu_t *emu, uint64_t cycles)
+	{
+		if (!emu->emulator->Running())
+			return 0;
+		return emu->emulator->RunCycles(cycles);
+	}
+
+	int casioemu_run_until(casioemu_t *emu, const casioemu_target_t *target)
+	{
+		Emulator::RunTarget run_target;
+		if (target->cycles)
+			run_target.cycle = emu->emulator->cycle_count + target->cycles;
+		run_target.address = target->pc;
+		if (target->lcd)
+		{
+			int width, height;
+			emu->emulator->chipset.screen->GetDotMatrixSize(width, height);
+			run_target.lcd.assign(target->lcd, target->lcd + width * height);
+		}
+		return emu->emulator->RunUntil(run_target);
+	}
+
+	double casioemu_achieved_mhz(casioemu_t *emu)
+	{
+		return emu->emulator->GetAchievedCyclesPerSecond() / 1000000;
+	}
+
+	uint64_t casioemu_cycles_per_second(casioemu_t *emu)
+	{
+		return emu->emulator->GetCyclesPerSecond();
+	}
+
+	int casioemu_is_paused(casioemu_t *emu)
+	{
+		return emu->emulator->GetPaused();
+	}
+
+	void casioemu_set_paused(casioemu_t *emu, int paused)
+	{
+		emu->emulator->SetPaused(paused);
+	}
+
+	void casioemu_press_key(casioemu_t *emu, uint8_t code)
+	{
+		emu->emulator->Input(Emulator::InputEvent(Emulator::InputEvent::IE_PRESS_KEY, 0, code));
+	}
+
+	void casioemu_release_key(casioemu_t *emu, uint8_t code)
+	{
+		emu->emulator->Input(Emulator::InputEvent(Emulator::InputEvent::IE_RELEASE_KEY, 0, code));
+	}
+
+	void casioemu_release_all_keys(casioemu_t *emu)
+	{
+		emu->emulator->Input(Emulator::InputEvent(Emulator::InputEvent::IE_RELEASE_ALL_KEYS));
+	}
+
+	void casioemu_lcd_size(casioemu_t *emu, int *width, int *height)
+	{
+		emu->emulator->chipset.screen->GetDotMatrixSize(*width, *height);
+	}
+
+	void casioemu_read_lcd(casioemu_t *emu, uint8_t *dots)
+	{
+		ScreenBase *screen = emu->emulator->chipset.screen;
+		screen->ReadDotMatrix(screen->LatestFrame(), dots);
+	}
+
+	void casioemu_read_memory(casioemu_t *emu, uint32_t address, uint8_t *buffer, size_t length)
+	{
+		Emulator::AccessLock access_lock(*emu->emulator);
+		for (size_t ix = 0; ix != length; ++ix)
+			buffer[ix] = emu->emulator->chipset.mmu.ReadData(address + ix, false);
+	}
+
+	void casioemu_write_memory(casioemu_t *emu, uint32_t address, const uint8_t *buffer, size_t length)
+	{
+		Emulator::InputEvent input(Emulator::InputEvent::IE_WRITE_DATA, address);
+		input.data.assign(buffer, buffer + length);
+		emu->emulator->Input(input);
+	}
+
+	int casioemu_save_ram(casioemu_t *emu, const char *path)
+	{
+		Emulator::AccessLock access_lock(*emu->emulator);
+		return emu->emulator->chipset.battery_backed_ram->SaveRAMImage(path) ? 0 : -1;
+	}
+
+	int casioemu_load_ram(casioemu_t *emu, const char *path)
+	{
+		Emulator::AccessLock access_lock(*emu->emulator);
+		return emu->emulator->chipset.battery_backed_ram->LoadRAMImage(path) ? 0 : -1;
+	}
+
+	int casioemu_save_state(casioemu_t *emu, const char *path)
+	{
+		return emu->emulator->SaveStateFile(path) ? 0 : -1;
+	}
+
+	int casioemu_load_state(casioemu_t *emu, const char *path)
+	{
+		return emu->emulator->LoadStateFile(path) ? 0 : -1;
+	}
+
+	void casioemu_start_recording(casioemu_t *emu)
+	{
+		emu->emulator->StartRecording();
+	}
+
+	int casioemu_stop_recording(casioemu_t *emu, const char *path)
+	{
+		return emu->emulator->StopRecording(path) ? 0 : -1;
+	}
+
+	int casioemu_replay(casioemu_t *emu, const char *path)
+	{
+		return emu->emulator->StartReplay(path) ? 0 : -1;
+	}
+
+	int casioemu_is_replaying(casioemu_t *emu)
+	{
+		Emulator::AccessLock access_lock(*emu->emulator);
+		return emu->emulator->Replaying();
+	}
+
+	int casioemu_rewind(casioemu_t *emu, uint64_t cycles)
+	{
+		return emu->emulator->Rewind(cycles) ? 0 : -1;
+	}
+
+	casioemu_t *casioemu_fork(casioemu_t *emu)
+	{
+		casioemu_t *fork = new casioemu_t;
+		fork->emulator = emu->emulator->Fork(fork->argv_map);
+		return fork;
+	}
+
+	int casioemu_fork_into(casioemu_t *emu, casioemu_t *target)
+	{
+		return emu->emulator->ForkInto(*target->emulator) ? 0 : -1;
+	}
+
+	void casioemu_execute(casioemu_t *emu, const char *command)
+	{
+		emu->emulator->ExecuteCommand(command);
+	}
+}
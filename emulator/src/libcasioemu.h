@@ -0,0 +1,150 @@
+/**
+ * C API of libcasioemu, the emulator core without the GUI, for driving
+ * calculators in-process (test harnesses, batch runs).
+ *
+ * Emulators created through this API are headless and don't run in real
+ * time: cycles are only emulated by `casioemu_run`. Any number of emulators
+ * may exist at once, each driven by its own thread; emulators of the same
+ * model share the ROM image.
+ */
+#ifndef LIBCASIOEMU_H
+#define LIBCASIOEMU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct casioemu_instance casioemu_t;
+
+/**
+ * Creates an emulator for the model in `model_dir`. `args` are `argc`
+ * additional command-line style arguments (`key=value`, see README.md),
+ * e.g. `ram=...` or `script=...`; `args` may be NULL if `argc` is 0.
+ * Like the emulator itself, this reports the error and exits the process if
+ * the model can't be loaded.
+ */
+casioemu_t *casioemu_create(const char *model_dir, int argc, const char *const *args);
+void casioemu_destroy(casioemu_t *emu);
+
+/**
+ * Emulates `cycles` cycles as fast as possible. Returns the number of cycles
+ * emulated, which is smaller if the emulator was paused (by a breakpoint, a
+ * watchpoint or a script) or shut down on the way.
+ */
+uint64_t casioemu_run(casioemu_t *emu, uint64_t cycles);
+/**
+ * Where `casioemu_run_until` stops: at the first of the parts that are set.
+ */
+typedef struct casioemu_target
+{
+	/* Number of cycles to emulate at most, 0 for no limit. */
+	uint64_t cycles;
+	/* Code address (CSR << 16 | PC) to stop before, -1 for none. */
+	int32_t pc;
+	/* Dot matrix to stop at (see `casioemu_read_lcd`), NULL for none. It's
+	 * compared every 10 ms of emulated time. */
+	const uint8_t *lcd;
+} casioemu_target_t;
+/**
+ * Emulates as fast as possible until `target` is met. Returns 1 if it was,
+ * 0 if the emulator was paused or shut down on the way. The emulator can be
+ * accessed from other threads while it runs.
+ */
+int casioemu_run_until(casioemu_t *emu, const casioemu_target_t *target);
+/**
+ * Emulated cycles per second of real time, in millions, measured over about
+ * the last second of running.
+ */
+double casioemu_achieved_mhz(casioemu_t *emu);
+/**
+ * Number of emulated cycles per emulated second.
+ */
+uint64_t casioemu_cycles_per_second(casioemu_t *emu);
+int casioemu_is_paused(casioemu_t *emu);
+void casioemu_set_paused(casioemu_t *emu, int paused);
+
+/**
+ * Keys are identified by their key code (KO bit index << 4 | KI bit index,
+ * 0xFF for the power button), as in key sequence files.
+ */
+void casioemu_press_key(casioemu_t *emu, uint8_t code);
+void casioemu_release_key(casioemu_t *emu, uint8_t code);
+void casioemu_release_all_keys(casioemu_t *emu);
+
+/**
+ * Size of the LCD dot matrix in dots, excluding the status line.
+ */
+void casioemu_lcd_size(casioemu_t *emu, int *width, int *height);
+/**
+ * Writes width * height bytes to `dots`, row by row, one ink level per dot:
+ * 0 or 1, on ClassWiz II 0 to 3 (grey levels of the two planes). This is the
+ * frame published at the end of the last run, read without waiting for the
+ * emulator; call it from one thread at a time.
+ */
+void casioemu_read_lcd(casioemu_t *emu, uint8_t *dots);
+
+/**
+ * Access `length` bytes of data memory at the 24-bit address `address`
+ * without triggering watchpoints.
+ */
+void casioemu_read_memory(casioemu_t *emu, uint32_t address, uint8_t *buffer, size_t length);
+void casioemu_write_memory(casioemu_t *emu, uint32_t address, const uint8_t *buffer, size_t length);
+
+/**
+ * Save/load the battery-backed RAM from/to a file. Return 0 on success.
+ */
+int casioemu_save_ram(casioemu_t *emu, const char *path);
+int casioemu_load_ram(casioemu_t *emu, const char *path);
+
+/**
+ * Save/load the whole machine state from/to a file, see `emu:save_state`.
+ * Return 0 on success. A state that doesn't match the model is refused and
+ * leaves the emulator as it was.
+ */
+int casioemu_save_state(casioemu_t *emu, const char *path);
+int casioemu_load_state(casioemu_t *emu, const char *path);
+
+/**
+ * Record/replay all external input (keys, port input, voltages, memory and
+ * register writes), see `emu:record`. `casioemu_stop_recording` and
+ * `casioemu_replay` return 0 on success. `casioemu_is_replaying` returns
+ * nonzero while the journal being replayed has events left.
+ */
+void casioemu_start_recording(casioemu_t *emu);
+int casioemu_stop_recording(casioemu_t *emu, const char *path);
+int casioemu_replay(casioemu_t *emu, const char *path);
+int casioemu_is_replaying(casioemu_t *emu);
+
+/**
+ * Puts the machine back in the state it was in `cycles` cycles ago, see
+ * `emu:rewind`. Returns 0 on success, -1 if the rewind buffer doesn't go back
+ * that far.
+ */
+int casioemu_rewind(casioemu_t *emu, uint64_t cycles);
+
+/**
+ * Creates an emulator in the state of `emu`, which shares its ROM and, until
+ * either of them writes to it, its RAM. Arguments are those of `emu` except
+ * `ram` and `script`, and the fork has no rewind buffer. Destroy it with `casioemu_destroy`.
+ */
+casioemu_t *casioemu_fork(casioemu_t *emu);
+/**
+ * Puts `target`, an emulator of the same model, in the state of `emu` the
+ * same way, without creating an emulator. Returns 0 on success, -1 if
+ * `target` runs another ROM.
+ */
+int casioemu_fork_into(casioemu_t *emu, casioemu_t *target);
+
+/**
+ * Executes a Lua command, like the emulator console.
+ */
+void casioemu_execute(casioemu_t *emu, const char *command);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif